@@ -0,0 +1,195 @@
+/*****************************************************
+ * ArrayStack.h
+ *
+ * Stack ADT implementation using a contiguous array.
+ * Unlike LinkedStack, push and pop don't allocate:
+ * the array only grows when it's full, and clear()
+ * keeps it so it can be reused for the next document.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef ARRAYSTACK_H
+#define ARRAYSTACK_H
+
+#include <iostream>
+#include <utility>
+#include "StackADT.h"
+
+template <class Type>
+class ArrayStack : public StackADT<Type>
+{
+	template <class T>
+	friend std::ostream& operator<<(std::ostream&, const ArrayStack<T>&);
+
+	public:
+		ArrayStack(int = DEFAULTAMT); // constructor with default parameter
+		ArrayStack(const ArrayStack<Type>&); // copy constructor
+		const ArrayStack<Type>& operator=(const ArrayStack<Type>&); // overload of = operator
+		~ArrayStack(); // destructor
+
+		void push(const Type&); // add to top of stack
+		void push(Type&&); // add to top of stack, moving the element
+		Type pop(); // remove and return top of stack
+		const Type& top() const; // return top of stack
+		const Type& peek(int) const; // return element below the top
+		void clear(); // empty the stack, keeping its storage
+	private:
+		void grow(); // double the capacity
+		void copyStack(const ArrayStack<Type>&); // Used by copy constructor and operator=
+
+		Type *elements; // bottom of the stack is elements[0]
+		int capacity;
+		static const int DEFAULTAMT = 32;
+};
+
+/* Constructor */
+template <class Type>
+ArrayStack<Type>::ArrayStack(int initialCapacity)
+{
+	if (initialCapacity < 1) // Make sure we get a valid number
+		initialCapacity = DEFAULTAMT;
+	capacity = initialCapacity;
+	elements = new Type[capacity];
+	this->currentSize = 0;
+}
+
+/* Copy constructor */
+template <class Type>
+ArrayStack<Type>::ArrayStack(const ArrayStack<Type>& otherStack)
+{
+	elements = nullptr;
+	copyStack(otherStack);
+}
+
+/* Overloading assignment operator (=) */
+template <class Type>
+const ArrayStack<Type>& ArrayStack<Type>::operator=(const ArrayStack<Type>& otherStack)
+{
+	if (this != &otherStack) // avoid self-assignment
+	{
+		delete [] elements;
+		copyStack(otherStack);
+	}
+
+	return *this;
+}
+
+/*
+ * copyStack
+ *
+ * Make this stack a copy of another stack.
+ * This code is shared by copy constructor and operator=.
+ */
+template <class Type>
+void ArrayStack<Type>::copyStack(const ArrayStack<Type>& otherStack)
+{
+	capacity = otherStack.capacity;
+	elements = new Type[capacity];
+	for (int i = 0; i < otherStack.currentSize; i++)
+		elements[i] = otherStack.elements[i];
+	this->currentSize = otherStack.currentSize;
+}
+
+/* Destructor */
+template <class Type>
+ArrayStack<Type>::~ArrayStack()
+{
+	delete [] elements;
+}
+
+/*
+ * grow
+ *
+ * Doubles the capacity, moving (not copying) the elements.
+ */
+template <class Type>
+void ArrayStack<Type>::grow()
+{
+	Type *bigger = new Type[2 * capacity];
+	for (int i = 0; i < this->currentSize; i++)
+		bigger[i] = std::move(elements[i]);
+	delete [] elements;
+	elements = bigger;
+	capacity *= 2;
+}
+
+template <class Type>
+void ArrayStack<Type>::push(const Type& obj)
+{
+	if (this->currentSize == capacity)
+		grow();
+	elements[this->currentSize++] = obj;
+}
+
+template <class Type>
+void ArrayStack<Type>::push(Type&& obj)
+{
+	if (this->currentSize == capacity)
+		grow();
+	elements[this->currentSize++] = std::move(obj);
+}
+
+template <class Type>
+Type ArrayStack<Type>::pop()
+{
+	if (this->isEmpty())
+		throw "EXCEPTION: Stack is empty!";
+	return std::move(elements[--this->currentSize]);
+}
+
+template <class Type>
+const Type& ArrayStack<Type>::top() const
+{
+	if (this->isEmpty())
+		throw "EXCEPTION: Stack is empty!";
+	return elements[this->currentSize - 1];
+}
+
+/*
+ * peek
+ *
+ * Retrieves an element without removing anything.
+ *
+ * Parameters: depth - How far below the top (0 is the top)
+ * Returns: The element at that depth
+ */
+template <class Type>
+const Type& ArrayStack<Type>::peek(int depth) const
+{
+	if (depth < 0 || depth >= this->currentSize)
+		throw "EXCEPTION: Not that many elements in the stack!";
+	return elements[this->currentSize - 1 - depth];
+}
+
+/*
+ * clear
+ *
+ * Removes all elements from the stack. The array is kept, so
+ * pushing again doesn't allocate.
+ */
+template <class Type>
+void ArrayStack<Type>::clear()
+{
+	this->currentSize = 0;
+}
+
+/*
+ * operator<<
+ *
+ * Overload the << operator to output the stack using an output stream.
+ * The top of the stack is printed last.
+ *
+ * Parameters: os    - Output stream to use
+ *             stack - stack to output
+ * Returns: Output stream that was used
+ */
+template <class Type>
+std::ostream& operator<<(std::ostream& os, const ArrayStack<Type>& stack)
+{
+	for (int i = 0; i < stack.currentSize; i++)
+		os << stack.elements[i] << " ";
+	os << "\n";
+	return os;
+}
+
+#endif
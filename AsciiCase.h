@@ -0,0 +1,175 @@
+/*****************************************************
+ * AsciiCase.h
+ *
+ * Case-insensitive hashing and comparison of tag
+ * names (<DIV> is <div>), without making a lowercase
+ * copy. Names are handled 8 bytes at a time: each
+ * 64-bit word is lowercased with a few arithmetic
+ * operations on all of its bytes at once, so a short
+ * name costs one or two words whatever its case.
+ *
+ * Only ASCII letters are folded; other bytes (UTF-8
+ * included) must match exactly.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef ASCIICASE_H
+#define ASCIICASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace AsciiCase
+{
+	const std::uint64_t ONES = 0x0101010101010101ULL; // 0x01 in every byte
+	const std::uint64_t HIGHS = 0x8080808080808080ULL; // 0x80 in every byte
+
+	/*
+	 * load
+	 *
+	 * Parameters: data   - First byte to load
+	 *             length - Bytes left from data (only up to 8 are loaded;
+	 *                      the word is padded with 0)
+	 * Returns: The bytes as a word
+	 */
+	inline std::uint64_t load(const char* data, std::size_t length)
+	{
+		std::uint64_t word = 0;
+		if (length >= 8)
+			std::memcpy(&word, data, 8); // A single load
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		// Two loads that may overlap, never past the name (the bytes they
+		// share land in the same place, so or-ing them changes nothing)
+		else if (length >= 4)
+		{
+			std::uint32_t first, last;
+			std::memcpy(&first, data, 4);
+			std::memcpy(&last, data + length - 4, 4);
+			word = first | (std::uint64_t)last << (8 * (length - 4));
+		}
+		else if (length > 0)
+			word = (std::uint64_t)(unsigned char)data[0] | (std::uint64_t)(unsigned char)data[length / 2] << (8 * (length / 2))
+			       | (std::uint64_t)(unsigned char)data[length - 1] << (8 * (length - 1));
+#else
+		else
+			for (std::size_t i = 0; i < length; i++)
+				word |= (std::uint64_t)(unsigned char)data[i] << (8 * i);
+#endif
+		return word;
+	}
+
+	/*
+	 * lowerWord
+	 *
+	 * Parameters: word - 8 bytes
+	 * Returns: The bytes with 'A'-'Z' turned into 'a'-'z'
+	 */
+	inline std::uint64_t lowerWord(std::uint64_t word)
+	{
+		std::uint64_t low = word & ~HIGHS; // Bytes without their high bit, so nothing carries over
+		std::uint64_t fromA = low + (0x80 - 'A') * ONES; // High bit set if the byte is 'A' or more
+		std::uint64_t pastZ = low + (0x80 - 'Z' - 1) * ONES; // High bit set if the byte is past 'Z'
+		std::uint64_t upper = (fromA ^ pastZ) & ~word & HIGHS; // 'A' to 'Z', and ASCII
+		return word | (upper >> 2); // 0x80 >> 2 is 0x20, the difference between cases
+	}
+
+	/*
+	 * head
+	 *
+	 * Parameters: name - Tag name, in any case
+	 * Returns: Its first 8 bytes in lower case, which is all of most names
+	 */
+	inline std::uint64_t head(std::string_view name)
+	{
+		return lowerWord(load(name.data(), name.size()));
+	}
+
+	/*
+	 * hash
+	 *
+	 * Parameters: name  - Tag name, in any case
+	 *             first - head(name), if it's already known
+	 * Returns: The same hash for every way of writing the name
+	 */
+	inline std::size_t hash(std::string_view name, std::uint64_t first)
+	{
+		std::uint64_t h = (name.size() * 0x9E3779B97F4A7C15ULL) ^ first;
+		for (std::size_t i = 8; i < name.size(); i += 8)
+		{
+			h *= 0xBF58476D1CE4E5B9ULL;
+			h ^= h >> 31;
+			h ^= lowerWord(load(name.data() + i, name.size() - i));
+		}
+		h *= 0xBF58476D1CE4E5B9ULL;
+		return (std::size_t)(h ^ (h >> 31));
+	}
+
+	inline std::size_t hash(std::string_view name)
+	{
+		return hash(name, head(name));
+	}
+
+	/*
+	 * equals
+	 *
+	 * Parameters: lower - Name in lower case (e.g. from a dictionary)
+	 *             name  - Name in any case
+	 * Returns: True if they are the same name
+	 */
+	inline bool equals(std::string_view lower, std::string_view name)
+	{
+		if (lower.size() != name.size())
+			return false;
+		for (std::size_t i = 0; i < name.size(); i += 8)
+			if (load(lower.data() + i, lower.size() - i) != lowerWord(load(name.data() + i, name.size() - i)))
+				return false;
+		return true;
+	}
+
+	/*
+	 * equalsAnyCase
+	 *
+	 * Parameters: a, b - Names in any case
+	 * Returns: True if they are the same name
+	 */
+	inline bool equalsAnyCase(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (std::size_t i = 0; i < a.size(); i += 8)
+			if (lowerWord(load(a.data() + i, a.size() - i)) != lowerWord(load(b.data() + i, b.size() - i)))
+				return false;
+		return true;
+	}
+
+	/*
+	 * lowered
+	 *
+	 * Parameters: name - Name in any case
+	 * Returns: A copy of the name in lower case
+	 */
+	inline std::string lowered(std::string_view name)
+	{
+		std::string copy(name);
+		for (char& c : copy)
+			if (c >= 'A' && c <= 'Z')
+				c = (char)(c + ('a' - 'A'));
+		return copy;
+	}
+
+	/* Hash and comparison for containers of names in any case */
+	struct Hash
+	{
+		std::size_t operator()(std::string_view name) const { return hash(name); }
+	};
+
+	struct Equal
+	{
+		bool operator()(std::string_view a, std::string_view b) const { return equalsAnyCase(a, b); }
+	};
+}
+
+#endif
@@ -0,0 +1,786 @@
+/********************************************************
+*   Project: HTML Validator using a stack and two sets
+*   Author: Gustavo A. Rassi
+*********************************************************
+* Description: Measures the validator and the data
+*              structures it uses on documents made up
+*              by HtmlGenerator, and prints the results
+*              as JSON so runs can be compared. Exits
+*              with 1 if going through a set allocated
+*              memory (the iterate/ benchmarks) or the
+*              versions of the delimiter scanner don't
+*              agree.
+*
+*   Usage: Benchmark [--size MB] [--depth N] [--errors RATE]
+*                    [--seed N] [--repeat N] [--only PREFIX]
+*                    [--out FILE] [--write FILE]
+********************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "ArrayStack.h"
+#include "ChunkedValidator.h"
+#include "DynamicSet.h"
+#include "HashSet.h"
+#include "HtmlGenerator.h"
+#include "IncrementalValidator.h"
+#include "LinkedStack.h"
+#include "MappedFile.h"
+#include "ReportWriter.h"
+#include "StaticSet.h"
+#include "TagDictionary.h"
+#include "ThreadPool.h"
+#include "Tokenizer.h"
+#include "Validator.h"
+using namespace std;
+
+/* Every allocation goes through here, so each benchmark can tell how
+ * many it made and how much memory it held at most. The size is kept
+ * in front of the block so operator delete knows it. */
+static atomic<long long> allocations(0), allocatedBytes(0), liveBytes(0), peakBytes(0);
+static const size_t HEADER = alignof(max_align_t);
+
+void* operator new(size_t size)
+{
+    char *block = (char *)malloc(size + HEADER);
+    if(block == nullptr)
+        throw bad_alloc();
+    *(size_t *)block = size;
+    allocations++;
+    allocatedBytes += size;
+    long long live = liveBytes += size;
+    long long peak = peakBytes;
+    while(live > peak && !peakBytes.compare_exchange_weak(peak, live))
+        ;
+    return block + HEADER;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if(pointer == nullptr)
+        return;
+    char *block = (char *)pointer - HEADER;
+    liveBytes -= *(size_t *)block;
+    free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+static volatile long long sink; // results nobody reads, so the work isn't optimized away
+
+struct Measurement
+{
+    string name;
+    string unit; // what items counts, e.g. "tags"
+    int runs;
+    double seconds; // fastest run
+    double bytes; // input bytes per run, 0 if it doesn't apply
+    double items; // items per run
+    long long allocations; // per run
+    long long allocatedBytes; // per run
+    long long peakHeapBytes; // most memory held at once, above what was held before
+    long peakRssKb; // peak resident memory of the whole process so far
+};
+
+struct Settings
+{
+    GeneratorOptions document;
+    int repeat = 5;
+    string only; // run only benchmarks whose name starts with this
+    string out; // file for the JSON, standard output if empty
+    string write; // write the document here and stop
+};
+
+/*
+ * peakRss
+ *
+ * Returns: Highest resident memory of the process so far, in KB
+ */
+long peakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+ * measure
+ *
+ * Runs a piece of work several times and keeps the fastest run, which
+ * is the one least disturbed by the rest of the machine.
+ *
+ * Parameters: results  - Where the measurement is added
+ *             settings - Amount of runs and filter
+ *             name     - Name of the benchmark
+ *             unit     - What the work counts
+ *             bytes    - Input bytes per run, 0 if it doesn't apply
+ *             work     - Does one run and returns how many items it did
+ */
+template <class Work>
+void measure(vector<Measurement>& results, const Settings& settings, const string& name,
+             const string& unit, double bytes, Work work)
+{
+    if(name.compare(0, settings.only.size(), settings.only) != 0)
+        return;
+    Measurement m = {name, unit, settings.repeat, 1e300, bytes, 0, 0, 0, 0, 0};
+    for(int run = 0; run < settings.repeat; run++)
+    {
+        long long allocationsBefore = allocations, bytesBefore = allocatedBytes;
+        long long liveBefore = liveBytes;
+        peakBytes = liveBefore;
+        auto start = chrono::steady_clock::now();
+        m.items = (double)work();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        m.seconds = min(m.seconds, seconds);
+        m.allocations = allocations - allocationsBefore;
+        m.allocatedBytes = allocatedBytes - bytesBefore;
+        m.peakHeapBytes = max(m.peakHeapBytes, (long long)peakBytes - liveBefore);
+    }
+    m.peakRssKb = peakRss();
+    results.push_back(m);
+    cerr << name << ": " << m.seconds * 1000 << " ms\n"; // Progress, away from the JSON
+}
+
+/*
+ * mayRun
+ *
+ * Parameters: settings - Filter of the benchmarks
+ *             group    - Start of the names of some benchmarks
+ * Returns: True if --only lets at least one of them run
+ */
+bool mayRun(const Settings& settings, const string& group)
+{
+    size_t common = min(group.size(), settings.only.size());
+    return group.compare(0, common, settings.only, 0, common) == 0;
+}
+
+/*
+ * makeWords
+ *
+ * Parameters: amount - Amount of words
+ *             first  - Number of the first word
+ * Returns: Distinct strings "w<first>", "w<first + 1>"...
+ */
+vector<string> makeWords(int amount, int first)
+{
+    vector<string> words;
+    words.reserve(amount);
+    for(int i = 0; i < amount; i++)
+        words.push_back("w" + to_string(first + i));
+    return words;
+}
+
+/* A version of the delimiter scanner */
+struct Scanner
+{
+    string name;
+    MarkupScanner markup;
+    TagEndScanner tagEnd;
+};
+
+/*
+ * supportedScanners
+ *
+ * Returns: The versions of the delimiter scanner this CPU can run
+ */
+vector<Scanner> supportedScanners()
+{
+    vector<Scanner> scanners = {{"scalar", scanMarkupScalar, scanTagEndScalar}};
+#ifdef DELIMITERSCAN_X86
+    if(__builtin_cpu_supports("sse2"))
+        scanners.push_back({"sse2", scanMarkupSSE2, scanTagEndSSE2});
+    if(__builtin_cpu_supports("avx2"))
+        scanners.push_back({"avx2", scanMarkupAVX2, scanTagEndAVX2});
+#endif
+    return scanners;
+}
+
+/*
+ * scanDocument
+ *
+ * Goes from one tag to the next with a version of the delimiter scanner,
+ * without looking at the tags themselves.
+ *
+ * Parameters: markup, tagEnd - Versions of the scanner to use
+ *             begin, end     - The document
+ *             line           - Incremented once per '\n'
+ * Returns: Amount of tags found
+ */
+long long scanDocument(MarkupScanner markup, TagEndScanner tagEnd, const char* begin, const char* end, int& line)
+{
+    const char *pos = begin;
+    long long tags = 0;
+    while((pos = markup(pos, end, line)) != end)
+    {
+        char quote = 0;
+        pos = tagEnd(pos + 1, end, line, quote);
+        if(pos == end)
+            break;
+        pos++;
+        tags++;
+    }
+    return tags;
+}
+
+/*
+ * checkScanners
+ *
+ * Every version of the delimiter scanner must find the same tags and
+ * lines as the scalar one, on generated documents full of attributes
+ * and on values that once fooled them (a "'" inside a value without
+ * quotes used to start a value that hid the tags after it).
+ *
+ * Returns: False if a version disagrees or a document is misread
+ */
+bool checkScanners(const TagDictionary& dictionary)
+{
+    GeneratorOptions options;
+    options.attributeRate = 0.6;
+    vector<string> documents;
+    for(bool minified : {false, true})
+    {
+        options.minified = minified;
+        documents.push_back(HtmlGenerator(dictionary, options).generate());
+    }
+    const string tricky = "<!DOCTYPE html>\n<html><body>\n<img alt=Don't>\n<bogus></span>\n<img alt=won't>\n"
+                          "<p title = \"a>b\" class=x'y lang=\n'en'>x</p>\n<a href=>y</a>\n</body></html>\n";
+    documents.push_back(tricky);
+
+    bool ok = true;
+    for(const string& document : documents)
+    {
+        const char *begin = document.data(), *end = document.data() + document.size();
+        int scalarLines = 0;
+        long long scalarTags = scanDocument(scanMarkupScalar, scanTagEndScalar, begin, end, scalarLines);
+        for(const Scanner& scanner : supportedScanners())
+        {
+            int lines = 0;
+            if(scanDocument(scanner.markup, scanner.tagEnd, begin, end, lines) != scalarTags || lines != scalarLines)
+            {
+                cerr << "The " << scanner.name << " scanner doesn't agree with the scalar one\n";
+                ok = false;
+            }
+        }
+    }
+    Validator validator(dictionary, numeric_limits<int>::max());
+    ValidationResult result = validator.validate(tricky.data(), tricky.data() + tricky.size());
+    if(result.errors.size() != 2 || result.errors[0].tag != "bogus" || result.errors[0].line != 4)
+    {
+        cerr << "Values without quotes hide tags from the validator\n";
+        ok = false;
+    }
+    return ok;
+}
+
+/*
+ * benchmarkDocuments
+ *
+ * The tokenizer alone, then the whole validator, on a document with
+ * line breaks and on a minified one full of attributes.
+ */
+void benchmarkDocuments(vector<Measurement>& results, const Settings& settings, const TagDictionary& dictionary)
+{
+    GeneratorOptions minifiedOptions = settings.document;
+    minifiedOptions.minified = true;
+    minifiedOptions.attributeRate = 0.6;
+    GeneratorOptions errorOptions = settings.document;
+    errorOptions.errorRate = max(settings.document.errorRate, 0.0001);
+
+    struct Document
+    {
+        string name;
+        GeneratorOptions options;
+    };
+    Document documents[] = {{"pretty", settings.document}, {"minified", minifiedOptions}};
+    for(const Document& document : documents)
+    {
+        HtmlGenerator generator(dictionary, document.options);
+        string html = generator.generate();
+        const char *begin = html.data(), *end = html.data() + html.size();
+        double bytes = (double)html.size();
+
+        for(const Scanner& scanner : supportedScanners()) // What the vector versions save
+            measure(results, settings, "scan/" + scanner.name + "/" + document.name, "tags", bytes, [&] {
+                int lines = 1;
+                long long tags = scanDocument(scanner.markup, scanner.tagEnd, begin, end, lines);
+                sink = lines;
+                return tags;
+            });
+        measure(results, settings, "tokenizer/" + document.name, "tags", bytes, [&] {
+            Tokenizer tokenizer(dictionary, begin, end);
+            Token token;
+            long long tags = 0;
+            while(tokenizer.next(token))
+                tags++;
+            return tags;
+        });
+        Validator validator(dictionary);
+        if(document.options.errorRate == 0 && validator.validate(begin, end).status != VALID)
+            cerr << "The " << document.name << " document should be valid but isn't\n";
+        measure(results, settings, "validator/" + document.name, "tags", bytes, [&] {
+            validator.validate(begin, end);
+            return generator.tagsMade();
+        });
+    }
+
+    HtmlGenerator generator(dictionary, settings.document);
+    string html = generator.generate();
+    // How splitting scales: 1, 2, 4... threads, and then every core
+    int cores = ThreadPool::defaultThreads();
+    for(int threads = 1; ; threads = min(2 * threads, cores))
+    {
+        ThreadPool pool(threads);
+        ChunkedValidator validator(dictionary, pool);
+        measure(results, settings, "validator/split-" + to_string(threads), "tags", (double)html.size(), [&] {
+            validator.validate(html.data(), html.data() + html.size());
+            return generator.tagsMade();
+        });
+        if(threads == cores)
+            break;
+    }
+
+    // An editor changing one line at a time, all over the document
+    IncrementalValidator editor(dictionary);
+    editor.load(html);
+    measure(results, settings, "incremental/edit-line", "edits", 0, [&] {
+        const int EDITS = 1000;
+        for(int i = 0; i < EDITS; i++)
+        {
+            int line = 2 + (int)((i * 7919LL) % (editor.lineCount() - 2));
+            editor.replaceLines(line, line, "  <p>edited</p>\n");
+            sink = editor.result().status;
+        }
+        return EDITS;
+    });
+
+    HtmlGenerator errorGenerator(dictionary, errorOptions);
+    string invalid = errorGenerator.generate();
+    Validator validator(dictionary, numeric_limits<int>::max()); // Read all of it, whatever the size
+    measure(results, settings, "validator/all-errors", "tags", (double)invalid.size(), [&] {
+        validator.validate(invalid.data(), invalid.data() + invalid.size());
+        return errorGenerator.tagsMade();
+    });
+
+    // Printing the errors of many files, to compare with validating them
+    ValidationResult errors = validator.validate(invalid.data(), invalid.data() + invalid.size());
+    FILE *devNull = fopen("/dev/null", "w");
+    const int FILES = 200;
+    long long records = (long long)FILES * errors.errors.size();
+    measure(results, settings, "report/flush-each", "records", 0, [&] { // What buffering saves
+        for(int i = 0; i < FILES; i++)
+            for(const ValidationError& error : errors.errors)
+            {
+                fprintf(devNull, "file%d.html: %s\n", i, errorMessage(error).c_str());
+                fflush(devNull);
+            }
+        return records;
+    });
+    const pair<const char*, ReportFormat> formats[] = {{"text", TEXT_REPORT}, {"jsonl", JSONL_REPORT}, {"sarif", SARIF_REPORT}};
+    for(const auto& format : formats)
+        measure(results, settings, string("report/") + format.first, "records", 0, [&] {
+            ReportWriter report(format.second, numeric_limits<int>::max(), devNull);
+            for(int i = 0; i < FILES; i++)
+                report.add("file" + to_string(i) + ".html", errors);
+            return records;
+        });
+    fclose(devNull);
+}
+
+/*
+ * benchmarkReading
+ *
+ * Reading a document from disk: a line at a time into a string, the way
+ * the validator used to, against mapping the file. Both count the '<' so
+ * they do the same work on the bytes. The file is written just before,
+ * so it comes from the page cache (use --size for a bigger file).
+ */
+void benchmarkReading(vector<Measurement>& results, const Settings& settings, const TagDictionary& dictionary)
+{
+    if(!mayRun(settings, "read/"))
+        return; // Don't write the file for nothing
+    HtmlGenerator generator(dictionary, settings.document);
+    char path[] = "/tmp/benchmark-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd == -1)
+    {
+        cerr << "Can't create a file for the read/ benchmarks\n";
+        return;
+    }
+    close(fd);
+    {
+        ofstream file(path, ios::binary);
+        file << generator.generate();
+    }
+    double bytes = (double)settings.document.bytes;
+
+    measure(results, settings, "read/ifstream", "bytes", bytes, [&] {
+        ifstream file(path);
+        string line;
+        long long tags = 0;
+        while(getline(file, line))
+            tags += count(line.begin(), line.end(), '<');
+        sink = tags;
+        return (long long)bytes;
+    });
+    measure(results, settings, "read/mmap", "bytes", bytes, [&] {
+        MappedFile file;
+        file.open(path);
+        sink = count(file.data(), file.data() + file.size(), '<');
+        return (long long)file.size();
+    });
+    unlink(path);
+}
+
+/*
+ * benchmarkStacks
+ *
+ * Pushes and pops a million tag IDs, the way the validator uses a stack.
+ */
+void benchmarkStacks(vector<Measurement>& results, const Settings& settings)
+{
+    const int AMOUNT = 1000000;
+    measure(results, settings, "linkedstack/push-pop", "ops", 0, [&] {
+        LinkedStack<int> stack;
+        long long sum = 0;
+        for(int i = 0; i < AMOUNT; i++)
+            stack.push(i);
+        while(!stack.isEmpty())
+            sum += stack.pop();
+        sink = sum;
+        return 2LL * AMOUNT;
+    });
+    measure(results, settings, "arraystack/push-pop", "ops", 0, [&] {
+        ArrayStack<int> stack;
+        long long sum = 0;
+        for(int i = 0; i < AMOUNT; i++)
+            stack.push(i);
+        while(!stack.isEmpty())
+            sum += stack.pop();
+        sink = sum;
+        return 2LL * AMOUNT;
+    });
+}
+
+/*
+ * lookupTags
+ *
+ * Looks up every tag name the way the validator used to, in the valid
+ * tags first and then, for a valid one, in the self-closing ones.
+ *
+ * Parameters: names     - Tag names to look up
+ *             validTags - Every tag
+ *             selfTags  - The self-closing tags
+ * Returns: Amount of names looked up
+ */
+template <class SetType>
+long long lookupTags(const vector<string>& names, const SetType& validTags, const SetType& selfTags)
+{
+    long long found = 0;
+    for(const string& name : names)
+        if(validTags.isElement(name))
+            found += 1 + selfTags.isElement(name);
+    sink = found;
+    return (long long)names.size();
+}
+
+/*
+ * benchmarkLookup
+ *
+ * Classifies the tag names of a generated document three ways: with the
+ * two sets the validator started with (StaticSet, which compares the
+ * name with every tag), with the same sets hashed, and with a single
+ * probe of the dictionary.
+ */
+void benchmarkLookup(vector<Measurement>& results, const Settings& settings, const TagDictionary& dictionary)
+{
+    if(!mayRun(settings, "lookup/"))
+        return; // Don't generate the document for nothing
+    vector<string> validTags, selfTags; // The same tags as tags.txt and self-closing.txt
+    for(int id = 0; id < dictionary.size(); id++)
+    {
+        validTags.push_back(dictionary.nameOf(id));
+        if(dictionary.kindOf(id) == SELF_CLOSING_TAG)
+            selfTags.push_back(dictionary.nameOf(id));
+    }
+    HtmlGenerator generator(dictionary, settings.document);
+    string html = generator.generate();
+    vector<string> names;
+    Tokenizer tokenizer(dictionary, html.data(), html.data() + html.size());
+    Token token;
+    while(tokenizer.next(token))
+        names.emplace_back(token.name);
+
+    StaticSet<string> staticValid(validTags.begin(), validTags.end()), staticSelf(selfTags.begin(), selfTags.end());
+    measure(results, settings, "lookup/staticset", "tags", 0, [&] {
+        return lookupTags(names, staticValid, staticSelf);
+    });
+    DynamicSet<string, HashSet<string> > hashValid(validTags.begin(), validTags.end()),
+                                         hashSelf(selfTags.begin(), selfTags.end());
+    measure(results, settings, "lookup/dynamicset-hash", "tags", 0, [&] {
+        return lookupTags(names, hashValid, hashSelf);
+    });
+    measure(results, settings, "lookup/dictionary", "tags", 0, [&] {
+        long long found = 0;
+        for(const string& name : names)
+            found += dictionary.kindOf(dictionary.idOf(name));
+        sink = found;
+        return (long long)names.size();
+    });
+}
+
+/*
+ * benchmarkSets
+ *
+ * Adds and looks up strings in DynamicSet, then runs the set algebra on
+ * two sets that share half of their elements.
+ */
+template <class SetType>
+void benchmarkSets(vector<Measurement>& results, const Settings& settings, const string& name, int amount, bool adds)
+{
+    vector<string> first = makeWords(amount, 0), second = makeWords(amount, amount / 2);
+    string size = to_string(amount / 1000) + "k";
+
+    if(adds) // StaticSet::add checks every element, so only for small sets
+        measure(results, settings, "dynamicset/" + name + "/add-" + size, "ops", 0, [&] {
+            DynamicSet<string, SetType> set;
+            for(size_t i = 0; i < first.size(); i++)
+                set.add(first[i]);
+            long long found = 0;
+            for(size_t i = 0; i < second.size(); i++)
+                found += set.isElement(second[i]);
+            sink = found;
+            return (long long)(first.size() + second.size());
+        });
+
+    // Includes building both sets from the words
+    measure(results, settings, "dynamicset/" + name + "/algebra-" + size, "ops", 0, [&] {
+        DynamicSet<string, SetType> a(first.begin(), first.end()), b(second.begin(), second.end());
+        sink = a.setunion(b).size() + a.intersection(b).size() + a.difference(b).size() + a.isSubset(b);
+        return 4LL;
+    });
+}
+
+/*
+ * iterateSet
+ *
+ * Goes through a set with range-for, which must not allocate.
+ *
+ * Parameters: results  - Where the measurement is added
+ *             settings - Amount of runs and filter
+ *             name     - Name of the benchmark
+ *             set      - Set to go through
+ * Returns: False if going through the set allocated memory
+ */
+template <class SetType>
+bool iterateSet(vector<Measurement>& results, const Settings& settings, const string& name, const SetType& set)
+{
+    size_t before = results.size();
+    measure(results, settings, name, "elements", 0, [&] {
+        long long elements = 0;
+        size_t length = 0;
+        for(const string& e : set)
+        {
+            elements++;
+            length += e.size();
+        }
+        sink = length;
+        return elements;
+    });
+    if(results.size() == before || results.back().allocations == 0)
+        return true;
+    cerr << name << ": " << results.back().allocations << " allocations while iterating\n";
+    return false;
+}
+
+/*
+ * benchmarkIteration
+ *
+ * Goes through each kind of set, checking that it allocates nothing.
+ *
+ * Returns: False if one of them allocated memory
+ */
+bool benchmarkIteration(vector<Measurement>& results, const Settings& settings)
+{
+    vector<string> words = makeWords(100000, 0);
+    StaticSet<string> staticSet(words.begin(), words.end());
+    HashSet<string> hashSet(words.begin(), words.end());
+    DynamicSet<string> dynamicSet(words.begin(), words.end());
+    DynamicSet<string, HashSet<string> > dynamicHashSet(words.begin(), words.end());
+    bool ok = iterateSet(results, settings, "iterate/static", staticSet);
+    ok = iterateSet(results, settings, "iterate/hash", hashSet) && ok;
+    ok = iterateSet(results, settings, "iterate/dynamic-static", dynamicSet) && ok;
+    ok = iterateSet(results, settings, "iterate/dynamic-hash", dynamicHashSet) && ok;
+    return ok;
+}
+
+/*
+ * addRebuilding
+ *
+ * DynamicSet::add as it was before it grew in place: when the set is
+ * full, copy it to an array, make a set twice as big and add every
+ * element back, checking each for duplicates again. (The old code also
+ * never freed the array; it's freed here so only the growth differs.)
+ *
+ * Parameters: set      - Set to add to
+ *             capacity - Amount of elements that fit in set, updated
+ *             e        - Element to add
+ */
+template <class Type, class SetType>
+void addRebuilding(SetType& set, int& capacity, const Type& e)
+{
+    if(set.size() == capacity)
+    {
+        Type *setAsArray = set.asArray();
+        set = SetType(2*capacity);
+        for(int i = 0; i < capacity; i++)
+            set.add(setAsArray[i]);
+        delete [] setAsArray;
+        capacity *= 2;
+    }
+    set.add(e);
+}
+
+/*
+ * benchmarkGrowth
+ *
+ * Adds a million strings to a DynamicSet that starts small, growing as
+ * it does now and as it used to. peak_heap_bytes is the memory each
+ * way needs; peak_rss_kb only says the same when run alone (--only).
+ */
+void benchmarkGrowth(vector<Measurement>& results, const Settings& settings)
+{
+    if(!mayRun(settings, "dynamicset/hash"))
+        return;
+    vector<string> words = makeWords(1000000, 0);
+    measure(results, settings, "dynamicset/hash/add-1m", "ops", 0, [&] {
+        DynamicSet<string, HashSet<string> > set;
+        for(const string& word : words)
+            set.add(word);
+        return (long long)set.size();
+    });
+    measure(results, settings, "dynamicset/hash-rebuild/add-1m", "ops", 0, [&] {
+        HashSet<string> set;
+        int capacity = set.maxSize();
+        for(const string& word : words)
+            addRebuilding(set, capacity, word);
+        return (long long)set.size();
+    });
+}
+
+/*
+ * writeJson
+ *
+ * Parameters: out      - Output stream to use
+ *             settings - What was measured
+ *             results  - The measurements
+ */
+void writeJson(ostream& out, const Settings& settings, const vector<Measurement>& results)
+{
+    out << "{\n  \"settings\": {\"size_bytes\": " << settings.document.bytes
+        << ", \"max_depth\": " << settings.document.maxDepth
+        << ", \"error_rate\": " << settings.document.errorRate
+        << ", \"seed\": " << settings.document.seed
+        << ", \"repeat\": " << settings.repeat
+        << ", \"threads\": " << ThreadPool::defaultThreads() << "},\n  \"results\": [";
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        const Measurement& m = results[i];
+        out << (i > 0 ? "," : "") << "\n    {\"name\": \"" << m.name << "\", \"runs\": " << m.runs
+            << ", \"seconds\": " << m.seconds;
+        if(m.bytes > 0)
+            out << ", \"mb_per_s\": " << m.bytes / m.seconds / 1e6;
+        out << ", \"" << m.unit << "_per_s\": " << m.items / m.seconds
+            << ", \"allocations\": " << m.allocations
+            << ", \"allocated_bytes\": " << m.allocatedBytes
+            << ", \"peak_heap_bytes\": " << m.peakHeapBytes
+            << ", \"peak_rss_kb\": " << m.peakRssKb << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+    Settings settings;
+    settings.document.bytes = 16 << 20;
+    for(int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "--size") == 0 && hasValue)
+            settings.document.bytes = (size_t)(atof(argv[++i]) * (1 << 20));
+        else if(strcmp(argv[i], "--depth") == 0 && hasValue)
+            settings.document.maxDepth = max(atoi(argv[++i]), 1);
+        else if(strcmp(argv[i], "--errors") == 0 && hasValue)
+            settings.document.errorRate = atof(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && hasValue)
+            settings.document.seed = strtoull(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "--repeat") == 0 && hasValue)
+            settings.repeat = max(atoi(argv[++i]), 1);
+        else if(strcmp(argv[i], "--only") == 0 && hasValue)
+            settings.only = argv[++i];
+        else if(strcmp(argv[i], "--out") == 0 && hasValue)
+            settings.out = argv[++i];
+        else if(strcmp(argv[i], "--write") == 0 && hasValue)
+            settings.write = argv[++i];
+        else
+        {
+            cerr << "Unknown option: " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    // Same tags as the validator; the built-in ones if the files aren't here
+    TagDictionary dictionary;
+    ifstream tags("tags.txt"), selfClosing("self-closing.txt");
+    string line;
+    while(getline(tags, line))
+        dictionary.addTag(line);
+    while(getline(selfClosing, line))
+        dictionary.addSelfClosing(line);
+    if(dictionary.isEmpty())
+        dictionary.addBuiltin();
+
+    if(!settings.write.empty()) // Only make a document, e.g. for the validator itself
+    {
+        HtmlGenerator generator(dictionary, settings.document);
+        ofstream file(settings.write, ios::binary);
+        file << generator.generate();
+        return file ? 0 : 1;
+    }
+
+    vector<Measurement> results;
+    benchmarkDocuments(results, settings, dictionary);
+    benchmarkReading(results, settings, dictionary);
+    benchmarkStacks(results, settings);
+    benchmarkLookup(results, settings, dictionary);
+    benchmarkSets<StaticSet<string> >(results, settings, "static", 10000, true);
+    benchmarkSets<StaticSet<string> >(results, settings, "static", 100000, false);
+    benchmarkSets<HashSet<string> >(results, settings, "hash", 10000, true);
+    benchmarkSets<HashSet<string> >(results, settings, "hash", 100000, true);
+    benchmarkGrowth(results, settings);
+    bool ok = benchmarkIteration(results, settings);
+    ok = checkScanners(dictionary) && ok;
+
+    if(settings.out.empty())
+        writeJson(cout, settings, results);
+    else
+    {
+        ofstream file(settings.out);
+        writeJson(file, settings, results);
+    }
+    return ok ? 0 : 1;
+}
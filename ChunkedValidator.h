@@ -0,0 +1,456 @@
+/*****************************************************
+ * ChunkedValidator.h
+ *
+ * Validates one very large document on many threads.
+ * The document is split into chunks right before a
+ * '<', and every chunk is tokenized on its own thread
+ * into a short summary: the closing tags it has for
+ * tags opened in earlier chunks, the tags it leaves
+ * open and the first error found inside it. Merging
+ * the summaries in order gives the same result as
+ * validating the whole document with one Validator.
+ *
+ * A chunk is read as if it started in plain text. If
+ * the chunk before it turns out to end inside a tag,
+ * a comment or raw text, that guess was wrong, and the
+ * chunk is read again by the tokenizer of the chunk
+ * before it, which knows the right state.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef CHUNKEDVALIDATOR_H
+#define CHUNKEDVALIDATOR_H
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ArrayStack.h"
+#include "AsciiCase.h"
+#include "MappedFile.h"
+#include "TagDictionary.h"
+#include "ThreadPool.h"
+#include "Tokenizer.h"
+#include "Validator.h"
+
+class ChunkedValidator
+{
+	public:
+		ChunkedValidator(const TagDictionary&, ThreadPool&, int = 1); // constructor, stops at the first error by default
+
+		ValidationResult validate(const char*, const char*); // validate bytes in memory
+		ValidationResult validateFile(const char*); // validate a file
+
+		static const size_t MINCHUNK = 1 << 20; // smaller documents aren't split
+		static const int CHUNKSPERTHREAD = 4; // so a slow chunk doesn't leave threads idle
+	private:
+		struct Closing // closing tag for a tag opened in an earlier chunk
+		{
+			int id;
+			int line; // counting from 1 at the start of the chunk
+			const char *at; // its '<'
+			std::string name;
+			bool opening; // instead, an opening tag right inside a tag of an earlier chunk (only with rules)
+		};
+
+		struct Chunk
+		{
+			const char *begin, *end;
+			const char *fedFrom; // first byte fed to the tokenizer that read the chunk
+			int lines; // '\n' in the chunk
+			std::vector<Closing> unmatched; // in the order they appear, with the openings to check
+			ArrayStack<int> open; // tags left open at the end of the chunk
+			std::vector<std::string> openCustom; // names of the custom elements in open, outermost first
+			bool failed; // an error was found inside the chunk
+			ValidationError error; // first error inside the chunk (line counted like unmatched)
+			const char *errorAt; // its '<'
+#ifdef HTMLVALIDATOR_STATS
+			int deepest; // most tags open at once, counted from the start of the chunk
+#endif
+		};
+
+		void split(const char*, const char*); // fill in the chunks
+		void checkChunk(Chunk&, Tokenizer&, bool); // tokenize a chunk into its summary
+		bool merge(Chunk&, int); // run a summary through the stack
+		bool closesTop(int, std::string_view, const ArrayStack<int>&, const std::vector<std::string>&) const;
+		std::string_view topName(const ArrayStack<int>&, const std::vector<std::string>&) const;
+		static void pop(ArrayStack<int>&, std::vector<std::string>&);
+		void fail(ValidationStatus, int, const char*, std::string_view, std::string_view = {});
+
+		const TagDictionary& dictionary;
+		const ContentModel& rules; // the dictionary's
+		ThreadPool& pool;
+		Validator sequential; // for small documents, and to collect every error
+		std::vector<Chunk> chunks;
+		std::vector<Tokenizer> tokenizers; // tokenizers[i] read chunks[i] first
+		ArrayStack<int> tags; // IDs of the open tags, from all merged chunks
+		std::vector<std::string> customTags; // names of the custom elements in tags, outermost first
+		ValidationResult result;
+		const char *documentBegin;
+		int maxErrors;
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Tags to validate against
+ *             threadPool    - Threads that tokenize the chunks
+ *             errorLimit    - Amount of errors to collect before stopping
+ */
+inline ChunkedValidator::ChunkedValidator(const TagDictionary& tagDictionary, ThreadPool& threadPool, int errorLimit)
+	: dictionary(tagDictionary), rules(tagDictionary.contentModel()), pool(threadPool), sequential(tagDictionary, errorLimit)
+{
+	maxErrors = errorLimit < 1 ? 1 : errorLimit;
+	documentBegin = nullptr;
+}
+
+/*
+ * split
+ *
+ * Splits the document into about the same amount of bytes per chunk.
+ * Every chunk but the first starts at a '<', so the chunk before it
+ * usually ends in plain text.
+ *
+ * Parameters: begin - First byte to split (right after line 1)
+ *             end   - One past the last byte of the document
+ */
+inline void ChunkedValidator::split(const char* begin, const char* end)
+{
+	size_t wanted = (size_t)pool.size() * CHUNKSPERTHREAD;
+	size_t most = (size_t)(end - begin) / MINCHUNK;
+	if (wanted > most)
+		wanted = most;
+	if (wanted < 1)
+		wanted = 1;
+	size_t step = (size_t)(end - begin) / wanted;
+
+	chunks.clear();
+	const char *start = begin;
+	for (size_t i = 1; i <= wanted; i++)
+	{
+		const char *cut = end;
+		if (i < wanted && begin + i * step > start)
+		{
+			cut = (const char *)memchr(begin + i * step, '<', end - (begin + i * step));
+			if (cut == nullptr)
+				cut = end;
+		}
+		if (cut == start)
+			continue;
+		Chunk chunk;
+		chunk.begin = chunk.fedFrom = start;
+		chunk.end = cut;
+		chunk.lines = 0;
+		chunk.failed = false;
+		chunk.error = ValidationError();
+		chunk.errorAt = nullptr;
+		chunks.push_back(std::move(chunk));
+		start = cut;
+		if (cut == end)
+			break;
+	}
+}
+
+/*
+ * closesTop
+ *
+ * Custom elements all have the same ID, so their names are compared.
+ *
+ * Parameters: id         - ID of a closing tag
+ *             name       - Its name
+ *             open       - Open tags (not empty)
+ *             openCustom - Names of the custom elements in open
+ * Returns: True if the closing tag closes the most recent open tag
+ */
+inline bool ChunkedValidator::closesTop(int id, std::string_view name, const ArrayStack<int>& open,
+	const std::vector<std::string>& openCustom) const
+{
+	return id == open.top() && (id != TagDictionary::CUSTOM_ID || AsciiCase::equalsAnyCase(openCustom.back(), name));
+}
+
+/*
+ * topName
+ *
+ * Parameters: open       - Open tags (not empty)
+ *             openCustom - Names of the custom elements in open
+ * Returns: Name of the most recent open tag
+ */
+inline std::string_view ChunkedValidator::topName(const ArrayStack<int>& open, const std::vector<std::string>& openCustom) const
+{
+	return open.top() == TagDictionary::CUSTOM_ID ? std::string_view(openCustom.back()) : std::string_view(dictionary.nameOf(open.top()));
+}
+
+/*
+ * pop
+ *
+ * Parameters: open       - Open tags; the most recent one is closed
+ *             openCustom - Names of the custom elements in open
+ */
+inline void ChunkedValidator::pop(ArrayStack<int>& open, std::vector<std::string>& openCustom)
+{
+	if (open.top() == TagDictionary::CUSTOM_ID)
+		openCustom.pop_back();
+	open.pop();
+}
+
+/*
+ * checkChunk
+ *
+ * Feeds a chunk to a tokenizer and sums up its tags. A closing tag with
+ * no open tag in the chunk is kept for the merge (and so is an opening
+ * tag, if there are content model rules), and everything after the
+ * first error inside the chunk is ignored, just as Validator stops.
+ *
+ * Parameters: chunk     - Chunk to read
+ *             tokenizer - Tokenizer in the state of the start of the chunk
+ *             isLast    - True for the last chunk of the document
+ */
+inline void ChunkedValidator::checkChunk(Chunk& chunk, Tokenizer& tokenizer, bool isLast)
+{
+	int firstLine = tokenizer.currentLine();
+	chunk.unmatched.clear();
+	chunk.open.clear();
+	chunk.openCustom.clear();
+	chunk.failed = false;
+#ifdef HTMLVALIDATOR_STATS
+	chunk.deepest = 0;
+#endif
+	tokenizer.feed(chunk.begin, chunk.end, isLast);
+
+	Token token;
+	while (tokenizer.next(token))
+	{
+		TagKind kind = dictionary.kindOf(token.id); // Tag was already looked up by the tokenizer
+		int line = token.line - firstLine + 1;
+		const char *at = chunk.fedFrom + token.offset;
+
+		if (token.closing && kind == CONTAINER_TAG)
+		{
+			if (chunk.open.isEmpty()) // Opened in an earlier chunk, if at all
+				chunk.unmatched.push_back({token.id, line, at, std::string(token.name), false});
+			else if (closesTop(token.id, token.name, chunk.open, chunk.openCustom))
+			{
+				pop(chunk.open, chunk.openCustom);
+				STATS_COUNT(POPS);
+			}
+			else
+			{
+				chunk.error = {MISMATCHED_TAG, line, 0, std::string(token.name),
+					std::string(topName(chunk.open, chunk.openCustom))};
+				chunk.failed = true;
+			}
+		}
+		else if (token.closing && kind == SELF_CLOSING_TAG) // Trying to close a self-closing tag
+		{
+			chunk.error = {CLOSED_SELF_CLOSING, line, 0, std::string(token.name), ""};
+			chunk.failed = true;
+		}
+		else if (kind != UNKNOWN_TAG && !rules.isEmpty()) // An opening tag, checked against the content model
+		{
+			if (chunk.open.isEmpty()) // Its parent is in an earlier chunk
+				chunk.unmatched.push_back({token.id, line, at, std::string(token.name), true});
+			else if (!rules.allows(chunk.open.top(), token.id))
+			{
+				chunk.error = {MISPLACED_TAG, line, 0, std::string(token.name), std::string(topName(chunk.open, chunk.openCustom))};
+				chunk.failed = true;
+			}
+		}
+
+		if (!token.closing && kind == CONTAINER_TAG && !chunk.failed)
+		{
+			chunk.open.push(token.id);
+			if (token.id == TagDictionary::CUSTOM_ID)
+				chunk.openCustom.emplace_back(token.name);
+			STATS_COUNT(PUSHES);
+#ifdef HTMLVALIDATOR_STATS
+			if (chunk.open.size() - (int)chunk.unmatched.size() > chunk.deepest)
+				chunk.deepest = chunk.open.size() - (int)chunk.unmatched.size();
+#endif
+		}
+		if (kind == UNKNOWN_TAG) // Tag doesn't exist or written incorrectly
+		{
+			chunk.error = {INVALID_TAG, line, 0, std::string(token.name), ""};
+			chunk.failed = true;
+		}
+
+		if (chunk.failed)
+		{
+			chunk.errorAt = at;
+			return;
+		}
+	}
+	chunk.lines = tokenizer.currentLine() - firstLine;
+}
+
+/*
+ * fail
+ *
+ * Records the error that ends the validation. The column is worked out
+ * from the document, since the chunk may start in the middle of a line.
+ *
+ * Parameters: status   - Kind of error
+ *             line     - Line of the error
+ *             at       - The '<' of the tag, or nullptr if no column applies
+ *             tag      - Tag that caused the error
+ *             expected - Open tag that should have been closed, if any
+ */
+inline void ChunkedValidator::fail(ValidationStatus status, int line, const char* at, std::string_view tag, std::string_view expected)
+{
+	int column = 0;
+	if (at != nullptr)
+	{
+		const char *lineStart = at;
+		while (lineStart != documentBegin && lineStart[-1] != '\n')
+			lineStart--;
+		column = (int)(at - lineStart) + 1;
+	}
+	ValidationError error = {status, line, column, std::string(tag), std::string(expected)};
+	(ValidationError&)result = error;
+	result.errors.push_back(std::move(error));
+}
+
+/*
+ * merge
+ *
+ * Closes the tags of earlier chunks that the chunk closes, then opens
+ * the ones it leaves open, the same way Validator would have.
+ *
+ * Parameters: chunk     - Summary of the chunk
+ *             firstLine - Line of the first byte of the chunk
+ * Returns: True if the chunk has no error, false otherwise
+ */
+inline bool ChunkedValidator::merge(Chunk& chunk, int firstLine)
+{
+	// Closing tags come before the error inside the chunk, if there's one
+	for (size_t i = 0; i < chunk.unmatched.size(); i++)
+	{
+		const Closing& closing = chunk.unmatched[i];
+		if (closing.opening) // Now its parent is known
+		{
+			int parent = tags.isEmpty() ? ContentModel::TOP : tags.top();
+			if (rules.allows(parent, closing.id))
+				continue;
+			fail(MISPLACED_TAG, firstLine + closing.line - 1, closing.at, closing.name,
+				parent == ContentModel::TOP ? std::string_view() : topName(tags, customTags));
+			return false;
+		}
+		if (!tags.isEmpty() && closesTop(closing.id, closing.name, tags, customTags))
+		{
+			pop(tags, customTags);
+			STATS_COUNT(POPS);
+			continue;
+		}
+		fail(MISMATCHED_TAG, firstLine + closing.line - 1, closing.at, closing.name,
+			tags.isEmpty() ? std::string_view() : topName(tags, customTags));
+		return false;
+	}
+	STATS_DEPTH(tags.size() + chunk.unmatched.size() + chunk.deepest); // Open when the chunk starts, plus its deepest point
+	if (chunk.failed)
+	{
+		fail(chunk.error.status, firstLine + chunk.error.line - 1, chunk.errorAt,
+			chunk.error.tag, chunk.error.expected);
+		return false;
+	}
+
+	for (int depth = chunk.open.size() - 1; depth >= 0; depth--) // Outermost first
+		tags.push(chunk.open.peek(depth)); // Already counted by checkChunk
+	for (std::string& name : chunk.openCustom) // Also outermost first
+		customTags.push_back(std::move(name));
+	return true;
+}
+
+/*
+ * validate
+ *
+ * Validates a whole document that's already in memory. When collecting
+ * every error, an invalid document is validated again by a single
+ * Validator, since recovering from an error depends on everything
+ * before it.
+ *
+ * Parameters: begin - First byte of the document
+ *             end   - One past the last byte of the document
+ * Returns: Result of the validation
+ */
+inline ValidationResult ChunkedValidator::validate(const char* begin, const char* end)
+{
+	const char *firstLineEnd = (const char *)memchr(begin, '\n', end - begin);
+	if (firstLineEnd == nullptr || (size_t)(end - firstLineEnd) < 2 * MINCHUNK || pool.size() < 2)
+		return sequential.validate(begin, end); // Not worth splitting
+
+	STATS_PHASE(VALIDATE);
+	STATS_COUNT(DOCUMENTS);
+	STATS_ADD(BYTES, end - begin);
+	result = ValidationResult();
+	result.status = VALID;
+	result.line = 1;
+	result.column = 0;
+	result.truncated = false;
+	documentBegin = begin;
+	tags.clear();
+	customTags.clear();
+	if (std::string_view(begin, firstLineEnd - begin) != DOCTYPE)
+	{
+		fail(MISSING_DOCTYPE, 1, nullptr, "");
+		return maxErrors > 1 ? sequential.validate(begin, end) : result;
+	}
+
+	// Tokenize every chunk at the same time, guessing it starts in plain text
+	split(firstLineEnd, end); // The tags start at the '\n' of line 1, like in Validator
+	int amount = (int)chunks.size();
+	tokenizers.clear();
+	tokenizers.reserve(amount);
+	for (int i = 0; i < amount; i++)
+	{
+		tokenizers.emplace_back(dictionary);
+		pool.submit([this, i, amount](int) {
+			checkChunk(chunks[i], tokenizers[i], i == amount - 1);
+		});
+	}
+	pool.wait();
+
+	// Merge the chunks in order
+	int origin = 0; // chunk whose tokenizer read the chunk being merged
+	int line = 1; // line of the first byte of the chunk being merged (line 1 ends there)
+	for (int i = 0; i < amount; i++)
+	{
+		if (i > 0 && !tokenizers[origin].betweenTags()) // Wrong guess: read it again
+		{
+			chunks[i].fedFrom = chunks[origin].fedFrom;
+			checkChunk(chunks[i], tokenizers[origin], i == amount - 1);
+		}
+		else
+			origin = i;
+
+		if (!merge(chunks[i], line))
+			return maxErrors > 1 ? sequential.validate(begin, end) : result;
+		line += chunks[i].lines;
+	}
+
+	// The whole file was read
+	int lastLine = (end[-1] == '\n') ? line - 1 : line; // Counted like getline
+	if (maxErrors == 1)
+		result.line = lastLine;
+	if (!tags.isEmpty()) // Opening tags are left unclosed
+	{
+		if (maxErrors > 1) // Reported where they were opened
+			return sequential.validate(begin, end);
+		fail(UNCLOSED_TAG, lastLine, nullptr, topName(tags, customTags));
+	}
+	return result;
+}
+
+/*
+ * validateFile
+ *
+ * Parameters: path - Path of the HTML file
+ * Returns: Result of the validation
+ */
+inline ValidationResult ChunkedValidator::validateFile(const char* path)
+{
+	MappedFile import; // Link with the HTML file, without copying it
+	if (!import.open(path) || compressionOf(import.data(), import.size()) != UNCOMPRESSED)
+		return sequential.validateFile(path); // Reports the missing file, or reads it as it's decompressed
+	return validate(import.data(), import.data() + import.size());
+}
+
+#endif
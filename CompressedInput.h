@@ -0,0 +1,324 @@
+/*****************************************************
+ * CompressedInput.h
+ *
+ * Reads gzip (and zstd) compressed documents a block
+ * at a time. A second thread decompresses the next
+ * blocks while the current one is being validated,
+ * and only a few blocks are kept, so the document is
+ * never decompressed whole into memory.
+ *
+ * The codecs are optional: build with
+ * -DHTMLVALIDATOR_WITH_ZLIB (and -lz) for .gz files,
+ * and with -DHTMLVALIDATOR_WITH_ZSTD (and -lzstd) for
+ * .zst files. Without them such files can't be read.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef COMPRESSEDINPUT_H
+#define COMPRESSEDINPUT_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef HTMLVALIDATOR_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HTMLVALIDATOR_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+enum Compression
+{
+	UNCOMPRESSED, // plain HTML
+	GZIP_COMPRESSED, // starts with 1f 8b
+	ZSTD_COMPRESSED // starts with 28 b5 2f fd
+};
+
+/*
+ * compressionOf
+ *
+ * Tells compressed files apart by their first bytes, so the name of the
+ * file doesn't matter (no HTML document starts with these bytes).
+ *
+ * Parameters: data - First bytes of the file
+ *             size - Amount of bytes in the file
+ * Returns: How the file is compressed
+ */
+inline Compression compressionOf(const char* data, std::size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	if (size >= 2 && bytes[0] == 0x1f && bytes[1] == 0x8b)
+		return GZIP_COMPRESSED;
+	if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd)
+		return ZSTD_COMPRESSED;
+	return UNCOMPRESSED;
+}
+
+/*
+ * canDecompress
+ *
+ * Returns: True if this build can read files compressed that way
+ */
+inline bool canDecompress(Compression compression)
+{
+	switch (compression)
+	{
+		case UNCOMPRESSED:
+			return true;
+		case GZIP_COMPRESSED:
+#ifdef HTMLVALIDATOR_WITH_ZLIB
+			return true;
+#else
+			return false;
+#endif
+		case ZSTD_COMPRESSED:
+#ifdef HTMLVALIDATOR_WITH_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+class Decompressor
+{
+	public:
+		Decompressor(const char*, std::size_t, Compression); // constructor, starts decompressing
+		Decompressor(const Decompressor&) = delete;
+		Decompressor& operator=(const Decompressor&) = delete;
+		~Decompressor(); // destructor, stops decompressing if it hasn't ended
+
+		bool next(const char*&, std::size_t&); // next block, valid until the following call
+		bool failed() const; // the data is damaged or can't be decompressed here
+
+		static const std::size_t BLOCKSIZE = 1 << 18; // decompressed bytes per block
+		static const int BLOCKS = 4; // blocks kept at once, one of them being read
+	private:
+		struct Block
+		{
+			std::vector<char> bytes;
+			std::size_t length;
+		};
+
+		void run(); // the decompressing thread
+		bool inflateAll(); // gzip
+		bool decompressZstd(); // zstd
+		char* startBlock(); // wait for a free block to fill, null to stop
+		void endBlock(std::size_t); // hand a filled block to the reader
+
+		const char *input;
+		std::size_t inputSize;
+		Compression compression;
+		Block blocks[BLOCKS];
+		long long produced; // blocks filled
+		long long taken; // blocks handed to the reader
+		long long released; // blocks the reader is done with
+		bool ended; // no more blocks will come
+		bool broken;
+		bool stopping; // the reader doesn't want the rest
+		mutable std::mutex lock; // protects everything above except the bytes
+		std::condition_variable filled, freed;
+		std::thread worker;
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: data   - Compressed bytes, kept until the object is destroyed
+ *             size   - Amount of compressed bytes
+ *             format - How they are compressed
+ */
+inline Decompressor::Decompressor(const char* data, std::size_t size, Compression format)
+	: input(data), inputSize(size), compression(format)
+{
+	produced = taken = released = 0;
+	ended = broken = stopping = false;
+	worker = std::thread(&Decompressor::run, this);
+}
+
+/* Destructor */
+inline Decompressor::~Decompressor()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	freed.notify_one();
+	worker.join();
+}
+
+/*
+ * next
+ *
+ * Waits for the next block of the document. The block returned before
+ * is given back to be filled again.
+ *
+ * Parameters: data   - Where the first byte of the block goes
+ *             length - Where the amount of bytes in the block goes
+ * Returns: True if there was a block, false at the end of the document
+ *          (or if it's damaged, see failed())
+ */
+inline bool Decompressor::next(const char*& data, std::size_t& length)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	if (released < taken)
+	{
+		released = taken;
+		freed.notify_one();
+	}
+	filled.wait(guard, [this] { return produced > taken || ended; });
+	if (produced == taken)
+		return false;
+	const Block& block = blocks[taken++ % BLOCKS];
+	data = block.bytes.data();
+	length = block.length;
+	return true;
+}
+
+inline bool Decompressor::failed() const
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return broken;
+}
+
+inline void Decompressor::run()
+{
+	bool complete = false;
+	if (compression == GZIP_COMPRESSED)
+		complete = inflateAll();
+	else if (compression == ZSTD_COMPRESSED)
+		complete = decompressZstd();
+	std::lock_guard<std::mutex> guard(lock);
+	broken = !complete && !stopping;
+	ended = true;
+	filled.notify_one();
+}
+
+inline char* Decompressor::startBlock()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	freed.wait(guard, [this] { return produced < released + BLOCKS || stopping; });
+	if (stopping)
+		return nullptr;
+	Block& block = blocks[produced % BLOCKS];
+	if (block.bytes.empty())
+		block.bytes.resize(BLOCKSIZE);
+	return block.bytes.data();
+}
+
+inline void Decompressor::endBlock(std::size_t length)
+{
+	if (length == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		blocks[produced % BLOCKS].length = length;
+		produced++;
+	}
+	filled.notify_one();
+}
+
+/*
+ * inflateAll
+ *
+ * Returns: True if the whole file was decompressed, false if it's
+ *          damaged, the reader stopped or zlib isn't built in
+ */
+inline bool Decompressor::inflateAll()
+{
+#ifdef HTMLVALIDATOR_WITH_ZLIB
+	z_stream stream = {};
+	if (inflateInit2(&stream, 15 + 16) != Z_OK) // gzip header only
+		return false;
+	const unsigned char *next = (const unsigned char *)input;
+	std::size_t left = inputSize;
+	int status = Z_OK;
+	char *block = nullptr;
+	while (true)
+	{
+		if (stream.avail_in == 0 && left > 0) // avail_in is only 32 bits
+		{
+			stream.next_in = (Bytef *)next;
+			stream.avail_in = (uInt)(left < (1u << 30) ? left : (1u << 30));
+			next += stream.avail_in;
+			left -= stream.avail_in;
+		}
+		if (!block && !(block = startBlock()))
+			break;
+		if (stream.avail_out == 0 || stream.next_out == nullptr)
+		{
+			stream.next_out = (Bytef *)block;
+			stream.avail_out = (uInt)BLOCKSIZE;
+		}
+		status = inflate(&stream, Z_NO_FLUSH);
+		if (status != Z_OK && status != Z_STREAM_END)
+			break;
+		if (stream.avail_out == 0)
+		{
+			endBlock(BLOCKSIZE);
+			block = nullptr;
+			stream.next_out = nullptr;
+		}
+		if (status == Z_STREAM_END)
+		{
+			if (stream.avail_in == 0 && left == 0)
+				break;
+			inflateReset(&stream); // Another gzip member follows
+		}
+	}
+	if (block && status == Z_STREAM_END)
+		endBlock(BLOCKSIZE - stream.avail_out);
+	inflateEnd(&stream);
+	return status == Z_STREAM_END;
+#else
+	return false;
+#endif
+}
+
+/*
+ * decompressZstd
+ *
+ * Returns: True if the whole file was decompressed, false if it's
+ *          damaged, the reader stopped or zstd isn't built in
+ */
+inline bool Decompressor::decompressZstd()
+{
+#ifdef HTMLVALIDATOR_WITH_ZSTD
+	ZSTD_DStream *stream = ZSTD_createDStream();
+	if (!stream)
+		return false;
+	ZSTD_initDStream(stream);
+	ZSTD_inBuffer in = {input, inputSize, 0};
+	std::size_t status = 1; // Not at the end of a frame
+	bool complete = false;
+	while (true)
+	{
+		char *block = startBlock();
+		if (!block)
+			break;
+		ZSTD_outBuffer out = {block, BLOCKSIZE, 0};
+		while (out.pos < out.size && (in.pos < in.size || status != 0))
+		{
+			std::size_t before = out.pos + in.pos;
+			status = ZSTD_decompressStream(stream, &out, &in);
+			if (ZSTD_isError(status) || out.pos + in.pos == before) // Damaged, or cut short
+				break;
+		}
+		endBlock(out.pos);
+		if (ZSTD_isError(status) || out.pos < out.size)
+		{
+			complete = !ZSTD_isError(status) && status == 0 && in.pos == in.size;
+			break;
+		}
+	}
+	ZSTD_freeDStream(stream);
+	return complete;
+#else
+	return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*****************************************************
+ * ContentHash.h
+ *
+ * Fast 64-bit hash of a block of bytes (the XXH64
+ * algorithm), for telling whether a file changed.
+ * It reads 32 bytes per step, so hashing a file
+ * costs much less than validating it. It isn't a
+ * cryptographic hash: it detects changes, not tampering.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ContentHashDetail
+{
+	const std::uint64_t PRIME1 = 11400714785074694791ull;
+	const std::uint64_t PRIME2 = 14029467366897019727ull;
+	const std::uint64_t PRIME3 = 1609587929392839161ull;
+	const std::uint64_t PRIME4 = 9650029242287828579ull;
+	const std::uint64_t PRIME5 = 2870177450012600261ull;
+
+	inline std::uint64_t rotate(std::uint64_t x, int bits)
+	{
+		return (x << bits) | (x >> (64 - bits));
+	}
+
+	inline std::uint64_t read64(const char* p)
+	{
+		std::uint64_t x;
+		std::memcpy(&x, p, 8); // the bytes may not be aligned
+		return x;
+	}
+
+	inline std::uint32_t read32(const char* p)
+	{
+		std::uint32_t x;
+		std::memcpy(&x, p, 4);
+		return x;
+	}
+
+	inline std::uint64_t round(std::uint64_t accumulator, std::uint64_t input)
+	{
+		accumulator += input * PRIME2;
+		return rotate(accumulator, 31) * PRIME1;
+	}
+
+	inline std::uint64_t mergeRound(std::uint64_t hash, std::uint64_t accumulator)
+	{
+		hash ^= round(0, accumulator);
+		return hash * PRIME1 + PRIME4;
+	}
+}
+
+/*
+ * contentHash
+ *
+ * Parameters: data   - First byte to hash
+ *             length - Amount of bytes
+ *             seed   - Gives a different hash for the same bytes
+ * Returns: 64-bit hash of the bytes
+ */
+inline std::uint64_t contentHash(const char* data, std::size_t length, std::uint64_t seed = 0)
+{
+	using namespace ContentHashDetail;
+	const char *p = data, *end = data + length;
+	std::uint64_t hash;
+
+	if (length >= 32)
+	{
+		std::uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+		for (; end - p >= 32; p += 32)
+		{
+			v1 = round(v1, read64(p));
+			v2 = round(v2, read64(p + 8));
+			v3 = round(v3, read64(p + 16));
+			v4 = round(v4, read64(p + 24));
+		}
+		hash = rotate(v1, 1) + rotate(v2, 7) + rotate(v3, 12) + rotate(v4, 18);
+		hash = mergeRound(hash, v1);
+		hash = mergeRound(hash, v2);
+		hash = mergeRound(hash, v3);
+		hash = mergeRound(hash, v4);
+	}
+	else
+		hash = seed + PRIME5;
+	hash += (std::uint64_t)length;
+
+	// The last 0 to 31 bytes
+	for (; end - p >= 8; p += 8)
+		hash = rotate(hash ^ round(0, read64(p)), 27) * PRIME1 + PRIME4;
+	if (end - p >= 4)
+	{
+		hash = rotate(hash ^ (read32(p) * PRIME1), 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	for (; p != end; p++)
+		hash = rotate(hash ^ ((unsigned char)*p * PRIME5), 11) * PRIME1;
+
+	// Make every bit of the input affect every bit of the hash
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+#endif
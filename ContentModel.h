@@ -0,0 +1,143 @@
+/*****************************************************
+ * ContentModel.h
+ *
+ * Which tags may be directly inside which (<li> only
+ * in <ul>, <ol> or <menu>, no <div> inside <p>...),
+ * compiled into a bit matrix indexed by the IDs of
+ * the parent and the child. Checking a tag against
+ * the top of the stack is a single bit lookup,
+ * whatever the amount of rules.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef CONTENTMODEL_H
+#define CONTENTMODEL_H
+
+#include <cstdint>
+#include <vector>
+#include "ContentHash.h"
+
+class ContentModel
+{
+	public:
+		ContentModel(); // constructor, allows everything
+
+		void resize(int); // make room for that many tag IDs, allowing everything
+		void forbid(int, int); // a child not allowed right inside a parent
+		void allowOnlyIn(int, const std::vector<int>&); // a child only allowed inside those parents
+		void allowOnly(int, const std::vector<int>&); // a parent only allowing those children
+		bool allows(int, int) const; // may the child be right inside the parent?
+		bool isEmpty() const; // true if there are no rules
+		std::uint64_t hash() const; // changes whenever the rules do
+
+		static const int TOP = -1; // parent of the tags outside of every other tag
+	private:
+		void set(int, int, bool);
+
+		int tags; // IDs below this have rules (others, e.g. custom elements, are always allowed)
+		int words; // words per row
+		std::vector<std::uint64_t> forbidden; // a row per parent, and a last one for TOP
+		bool empty;
+};
+
+/* Constructor */
+inline ContentModel::ContentModel()
+{
+	tags = 0;
+	words = 0;
+	empty = true;
+}
+
+/*
+ * resize
+ *
+ * Removes every rule and makes room for the tags of a dictionary.
+ *
+ * Parameters: amount - Amount of tag IDs (0 to amount - 1)
+ */
+inline void ContentModel::resize(int amount)
+{
+	tags = amount < 0 ? 0 : amount;
+	words = (tags + 63) / 64;
+	forbidden.assign((size_t)(tags + 1) * words, 0);
+	empty = true;
+}
+
+inline void ContentModel::set(int parent, int child, bool isForbidden)
+{
+	if (child < 0 || child >= tags || parent < TOP || parent >= tags)
+		return;
+	std::uint64_t& word = forbidden[(size_t)(parent == TOP ? tags : parent) * words + child / 64];
+	std::uint64_t bit = (std::uint64_t)1 << (child % 64);
+	word = isForbidden ? (word | bit) : (word & ~bit);
+	if (isForbidden)
+		empty = false;
+}
+
+/*
+ * forbid
+ *
+ * Parameters: parent - ID of the parent, or TOP
+ *             child  - ID of the child
+ */
+inline void ContentModel::forbid(int parent, int child)
+{
+	set(parent, child, true);
+}
+
+/*
+ * allowOnlyIn
+ *
+ * Parameters: child   - ID of the child
+ *             parents - The only parents it may have (TOP included)
+ */
+inline void ContentModel::allowOnlyIn(int child, const std::vector<int>& parents)
+{
+	for (int parent = TOP; parent < tags; parent++)
+		set(parent, child, true);
+	for (int parent : parents)
+		set(parent, child, false);
+}
+
+/*
+ * allowOnly
+ *
+ * Parameters: parent   - ID of the parent, or TOP
+ *             children - The only children it may have
+ */
+inline void ContentModel::allowOnly(int parent, const std::vector<int>& children)
+{
+	for (int child = 0; child < tags; child++)
+		set(parent, child, true);
+	for (int child : children)
+		set(parent, child, false);
+}
+
+/*
+ * allows
+ *
+ * Parameters: parent - ID of the tag on top of the stack, or TOP
+ *             child  - ID of the tag being opened
+ * Returns: True unless a rule forbids it
+ */
+inline bool ContentModel::allows(int parent, int child) const
+{
+	if ((unsigned)child >= (unsigned)tags || (unsigned)(parent + 1) > (unsigned)tags) // No rules for them
+		return true;
+	int row = (parent == TOP) ? tags : parent;
+	return !((forbidden[(size_t)row * words + child / 64] >> (child % 64)) & 1);
+}
+
+inline bool ContentModel::isEmpty() const
+{
+	return empty;
+}
+
+inline std::uint64_t ContentModel::hash() const
+{
+	if (empty)
+		return 0;
+	return contentHash((const char *)forbidden.data(), forbidden.size() * sizeof(std::uint64_t), (std::uint64_t)tags);
+}
+
+#endif
@@ -0,0 +1,373 @@
+/*****************************************************
+ * DelimiterScan.h
+ *
+ * Fast search for the next '<' in the text between
+ * tags, and for the '>' that ends a tag. Most of an
+ * HTML file is text and attributes, so instead of
+ * looking at it one character at a time, 16 (SSE2)
+ * or 32 (AVX2) bytes are compared at once. The '\n'
+ * characters that are skipped are counted on the way
+ * so line numbers stay correct.
+ *
+ * The best version for the CPU is picked at runtime;
+ * the scalar version is used everywhere else.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef DELIMITERSCAN_H
+#define DELIMITERSCAN_H
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define DELIMITERSCAN_X86
+#include <immintrin.h>
+#endif
+
+/* Signature shared by all the versions of the scanner.
+ * Parameters: pos  - First byte to look at
+ *             end  - One past the last byte
+ *             line - Incremented once per '\n' skipped
+ * Returns: Position of the first '<', or end if there's none */
+typedef const char* (*MarkupScanner)(const char*, const char*, int&);
+
+/* Where the tag end scanners are in the attributes, besides 0 (names,
+ * spaces, after a value) and the quote of a value in quotes. Like in the
+ * HTML attribute value states, a quote only starts a value if it's the
+ * first byte after the '=' and the spaces that follow it: in
+ * <img alt=Don't> the "'" is part of the value. */
+const char BEFORE_VALUE = '='; // after an '=', no value yet
+const char UNQUOTED_VALUE = 'v'; // inside a value without quotes
+
+/* Signature shared by all the versions of the tag end scanner.
+ * Parameters: pos   - First byte to look at, inside a tag
+ *             end   - One past the last byte
+ *             line  - Incremented once per '\n' skipped
+ *             quote - Where pos is in the attributes: 0, BEFORE_VALUE,
+ *                     UNQUOTED_VALUE or the quote of the value ('"' or '\'');
+ *                     updated when the end of the tag isn't found, and
+ *                     0 when it is
+ * Returns: Position of the '>' that ends the tag, or end if it isn't there */
+typedef const char* (*TagEndScanner)(const char*, const char*, int&, char&);
+
+/*
+ * isAttributeSpace
+ *
+ * Returns: True for the bytes HTML skips between attributes
+ */
+inline bool isAttributeSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f';
+}
+
+/*
+ * scanMarkupScalar
+ *
+ * Portable version, one byte at a time.
+ */
+inline const char* scanMarkupScalar(const char* pos, const char* end, int& line)
+{
+	while (pos != end && *pos != '<')
+	{
+		if (*pos == '\n')
+			line++;
+		pos++;
+	}
+	return pos;
+}
+
+/*
+ * scanTagEndScalar
+ *
+ * Portable version, one byte at a time. A value in quotes goes on until
+ * the same quote, and a '>' in it doesn't count.
+ */
+inline const char* scanTagEndScalar(const char* pos, const char* end, int& line, char& quote)
+{
+	for (; pos != end; pos++)
+	{
+		char c = *pos;
+		if (c == '\n')
+			line++;
+		switch (quote)
+		{
+			case 0:
+				if (c == '>')
+					return pos;
+				if (c == '=')
+					quote = BEFORE_VALUE;
+				break;
+			case BEFORE_VALUE:
+				if (isAttributeSpace(c))
+					break;
+				if (c == '>') // <a href=>
+				{
+					quote = 0;
+					return pos;
+				}
+				quote = (c == '"' || c == '\'') ? c : UNQUOTED_VALUE;
+				break;
+			case UNQUOTED_VALUE:
+				if (c == '>')
+				{
+					quote = 0;
+					return pos;
+				}
+				if (isAttributeSpace(c))
+					quote = 0;
+				break;
+			default: // In quotes
+				if (c == quote)
+					quote = 0;
+		}
+	}
+	return pos;
+}
+
+#ifdef DELIMITERSCAN_X86
+
+/*
+ * tagEndInBlock
+ *
+ * Finds the end of a tag in one block of up to 32 bytes, given the bit
+ * masks of its bytes (bit i is byte i). Used by the vector versions of
+ * scanTagEnd.
+ *
+ * Outside of values only '>' and '=' matter, so a tag without values is
+ * a single bit scan. Otherwise the block is walked from one byte that
+ * changes the state to the next (an '=', the first byte of the value,
+ * the quote or space that ends it...), skipping everything in between.
+ *
+ * Parameters: gt, eq, dq, sq - Bits of the '>', '=', '"' and '\''
+ *             nl, space      - Bits of the '\n' and of every attribute space
+ *             all            - Bits of every byte of the block
+ *             line           - Incremented once per '\n' skipped
+ *             quote          - Where the block starts in the attributes
+ *                              (see TagEndScanner); updated like it
+ * Returns: Index of the '>' that ends the tag, or -1 if it isn't in the block
+ */
+inline int tagEndInBlock(unsigned gt, unsigned eq, unsigned dq, unsigned sq, unsigned nl, unsigned space,
+                         unsigned all, int& line, char& quote)
+{
+	if (quote == 0 && eq == 0) // Most tags
+	{
+		if (gt == 0)
+		{
+			line += __builtin_popcount(nl);
+			return -1;
+		}
+		int i = __builtin_ctz(gt);
+		line += __builtin_popcount(nl & ((1u << i) - 1));
+		return i;
+	}
+
+	unsigned done = 0; // bits already looked at
+	while (true)
+	{
+		unsigned next;
+		switch (quote)
+		{
+			case 0: next = gt | eq; break;
+			case BEFORE_VALUE: next = all & ~space; break;
+			case UNQUOTED_VALUE: next = gt | space; break;
+			case '"': next = dq; break;
+			default: next = sq;
+		}
+		next &= ~done;
+		if (next == 0)
+		{
+			line += __builtin_popcount(nl & ~done);
+			return -1;
+		}
+		int i = __builtin_ctz(next);
+		unsigned bit = 1u << i;
+		unsigned upTo = (i == 31) ? ~0u : (2u << i) - 1;
+		line += __builtin_popcount(nl & ~done & upTo);
+		done |= upTo;
+		if (quote == '"' || quote == '\'')
+			quote = 0;
+		else if (gt & bit) // A '>' that counts is never inside a value
+		{
+			quote = 0;
+			return i;
+		}
+		else if (quote == 0)
+			quote = BEFORE_VALUE;
+		else if (quote == UNQUOTED_VALUE)
+			quote = 0;
+		else // First byte of the value
+			quote = (dq & bit) ? '"' : (sq & bit) ? '\'' : UNQUOTED_VALUE;
+	}
+}
+
+/*
+ * scanMarkupSSE2
+ *
+ * 16 bytes per step. The '<' bits of the block give the position of the
+ * delimiter, and the '\n' bits before it give the lines skipped.
+ */
+__attribute__((target("sse2")))
+inline const char* scanMarkupSSE2(const char* pos, const char* end, int& line)
+{
+	const __m128i lt = _mm_set1_epi8('<');
+	const __m128i nl = _mm_set1_epi8('\n');
+	while (end - pos >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)pos);
+		unsigned found = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, lt));
+		unsigned newlines = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl));
+		if (found != 0)
+		{
+			unsigned i = (unsigned)__builtin_ctz(found);
+			line += __builtin_popcount(newlines & ((1u << i) - 1));
+			return pos + i;
+		}
+		line += __builtin_popcount(newlines);
+		pos += 16;
+	}
+	return scanMarkupScalar(pos, end, line); // less than one block left
+}
+
+/*
+ * scanMarkupAVX2
+ *
+ * Same as scanMarkupSSE2, 32 bytes per step.
+ */
+__attribute__((target("avx2,popcnt")))
+inline const char* scanMarkupAVX2(const char* pos, const char* end, int& line)
+{
+	const __m256i lt = _mm256_set1_epi8('<');
+	const __m256i nl = _mm256_set1_epi8('\n');
+	while (end - pos >= 32)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)pos);
+		unsigned found = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, lt));
+		unsigned newlines = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, nl));
+		if (found != 0)
+		{
+			unsigned i = (unsigned)__builtin_ctz(found);
+			/* i can be 31, so shift a 64-bit 1 to build the mask */
+			line += __builtin_popcount(newlines & (unsigned)((1ull << i) - 1));
+			return pos + i;
+		}
+		line += __builtin_popcount(newlines);
+		pos += 32;
+	}
+	return scanMarkupSSE2(pos, end, line); // less than one block left
+}
+
+/*
+ * scanTagEndSSE2
+ *
+ * 16 bytes per step. The values inside the block are worked out from
+ * bit masks, so attributes don't cost a branch per character.
+ */
+__attribute__((target("sse2")))
+inline const char* scanTagEndSSE2(const char* pos, const char* end, int& line, char& quote)
+{
+	const __m128i gt = _mm_set1_epi8('>');
+	const __m128i eq = _mm_set1_epi8('=');
+	const __m128i dq = _mm_set1_epi8('"');
+	const __m128i sq = _mm_set1_epi8('\'');
+	const __m128i nl = _mm_set1_epi8('\n');
+	const __m128i sp = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i ff = _mm_set1_epi8('\f');
+	while (end - pos >= 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *)pos);
+		__m128i newlines = _mm_cmpeq_epi8(block, nl);
+		__m128i spaces = _mm_or_si128(_mm_or_si128(newlines, _mm_cmpeq_epi8(block, sp)),
+		                              _mm_or_si128(_mm_cmpeq_epi8(block, tab),
+		                                           _mm_or_si128(_mm_cmpeq_epi8(block, cr), _mm_cmpeq_epi8(block, ff))));
+		int i = tagEndInBlock((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, gt)),
+		                      (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, eq)),
+		                      (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, dq)),
+		                      (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, sq)),
+		                      (unsigned)_mm_movemask_epi8(newlines),
+		                      (unsigned)_mm_movemask_epi8(spaces), 0xFFFFu, line, quote);
+		if (i >= 0)
+			return pos + i;
+		pos += 16;
+	}
+	return scanTagEndScalar(pos, end, line, quote); // less than one block left
+}
+
+/*
+ * scanTagEndAVX2
+ *
+ * Same as scanTagEndSSE2, 32 bytes per step.
+ */
+__attribute__((target("avx2,popcnt")))
+inline const char* scanTagEndAVX2(const char* pos, const char* end, int& line, char& quote)
+{
+	const __m256i gt = _mm256_set1_epi8('>');
+	const __m256i eq = _mm256_set1_epi8('=');
+	const __m256i dq = _mm256_set1_epi8('"');
+	const __m256i sq = _mm256_set1_epi8('\'');
+	const __m256i nl = _mm256_set1_epi8('\n');
+	const __m256i sp = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i ff = _mm256_set1_epi8('\f');
+	while (end - pos >= 32)
+	{
+		__m256i block = _mm256_loadu_si256((const __m256i *)pos);
+		__m256i newlines = _mm256_cmpeq_epi8(block, nl);
+		__m256i spaces = _mm256_or_si256(_mm256_or_si256(newlines, _mm256_cmpeq_epi8(block, sp)),
+		                                 _mm256_or_si256(_mm256_cmpeq_epi8(block, tab),
+		                                                 _mm256_or_si256(_mm256_cmpeq_epi8(block, cr), _mm256_cmpeq_epi8(block, ff))));
+		int i = tagEndInBlock((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, gt)),
+		                      (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, eq)),
+		                      (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, dq)),
+		                      (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, sq)),
+		                      (unsigned)_mm256_movemask_epi8(newlines),
+		                      (unsigned)_mm256_movemask_epi8(spaces), 0xFFFFFFFFu, line, quote);
+		if (i >= 0)
+			return pos + i;
+		pos += 32;
+	}
+	return scanTagEndSSE2(pos, end, line, quote); // less than one block left
+}
+
+#endif
+
+/*
+ * bestMarkupScanner
+ *
+ * Picks the fastest version supported by this CPU. The choice is made
+ * once and reused afterwards.
+ *
+ * Returns: Scanner to use
+ */
+inline MarkupScanner bestMarkupScanner()
+{
+#ifdef DELIMITERSCAN_X86
+	static const MarkupScanner best =
+		__builtin_cpu_supports("avx2") ? scanMarkupAVX2 :
+		__builtin_cpu_supports("sse2") ? scanMarkupSSE2 : scanMarkupScalar;
+	return best;
+#else
+	return scanMarkupScalar;
+#endif
+}
+
+/*
+ * bestTagEndScanner
+ *
+ * Same as bestMarkupScanner, for the end of a tag.
+ *
+ * Returns: Scanner to use
+ */
+inline TagEndScanner bestTagEndScanner()
+{
+#ifdef DELIMITERSCAN_X86
+	static const TagEndScanner best =
+		__builtin_cpu_supports("avx2") ? scanTagEndAVX2 :
+		__builtin_cpu_supports("sse2") ? scanTagEndSSE2 : scanTagEndScalar;
+	return best;
+#else
+	return scanTagEndScalar;
+#endif
+}
+
+#endif
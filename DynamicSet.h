@@ -6,23 +6,34 @@
 * Authors: Juan O. Lopez & Gustavo A. Rassi
 ******************************************/
 #include <iostream>
+#include <utility>
 #include "StaticSet.h"
 
 #ifndef DYNAMICSET_H
 #define DYNAMICSET_H
 
-template <class Type>
+/* SetType is the fixed-capacity set that stores the elements. It defaults
+ * to StaticSet, but HashSet can be used when fast lookups are needed. */
+template <class Type, class SetType = StaticSet<Type> >
 class DynamicSet
 {
-	template <class T>
-	friend std::ostream& operator<<(std::ostream&, const DynamicSet<T>&);
+	template <class T, class S>
+	friend std::ostream& operator<<(std::ostream&, const DynamicSet<T, S>&);
 
 	public:
+		typedef typename SetType::const_iterator const_iterator;
+
 		DynamicSet(int = 10); // constructor with default parameter
-		DynamicSet(const DynamicSet<Type>&); // copy constructor
-		const DynamicSet<Type>& operator=(const DynamicSet<Type>&); // Overload =
+		template <class Iterator>
+		DynamicSet(Iterator, Iterator); // constructor from a range of elements
+		DynamicSet(const DynamicSet<Type, SetType>&); // copy constructor
+		DynamicSet(DynamicSet<Type, SetType>&&); // move constructor
+		const DynamicSet<Type, SetType>& operator=(const DynamicSet<Type, SetType>&); // Overload =
+		const DynamicSet<Type, SetType>& operator=(DynamicSet<Type, SetType>&&); // Overload = (move)
 		//~DynamicSet();  Destructor of Static Set will be automatically invoked
 
+		void reserve(int); // make room for more elements
+		void shrinkToFit(); // release the room that isn't used
 		void add(const Type &);
 		bool remove(const Type &); // remove a single copy
 		int removeAll(const Type &); // remove ALL copies
@@ -30,43 +41,62 @@ class DynamicSet
 		bool isElement(const Type &) const;
 		int size() const; // amount of elements
 		bool isEmpty() const;
-		DynamicSet<Type> setunion(const DynamicSet<Type> &) const;
-		DynamicSet<Type> intersection(const DynamicSet<Type> &) const;
-		DynamicSet<Type> difference(const DynamicSet<Type> &) const;
-		bool isSubset(const DynamicSet<Type> &) const;
+		DynamicSet<Type, SetType> setunion(const DynamicSet<Type, SetType> &) const;
+		DynamicSet<Type, SetType> intersection(const DynamicSet<Type, SetType> &) const;
+		DynamicSet<Type, SetType> difference(const DynamicSet<Type, SetType> &) const;
+		bool isSubset(const DynamicSet<Type, SetType> &) const;
 		Type* asArray() const;
+		const_iterator begin() const; // first element (no particular order)
+		const_iterator end() const; // one past the last element
 	private:
 		int capacity;
 		/* Instead of directly manipulating an elements array,
 		 * we use a DynamicSet object to handle everything for us
 		 * (except the add method in case the set is full). */
 		//Type *elements;
-		StaticSet<Type> theSet; // object composition
+		SetType theSet; // object composition
 };
 
 /* Implementation included in the same file due to the use of templates. */
 
 /* Constructor */
-template <class Type>
-DynamicSet<Type>::DynamicSet(int initialCapacity)
+template <class Type, class SetType>
+DynamicSet<Type, SetType>::DynamicSet(int initialCapacity)
 {
 	if (initialCapacity < 1) // Make sure we get a valid number
 		initialCapacity = 10; // Same as default parameter
 	capacity = initialCapacity;
-	theSet = StaticSet<Type>(capacity); // Uses operator=
+	theSet = SetType(capacity); // Uses operator=
+}
+
+/*
+ * Constructor
+ *
+ * Builds the set from a range of elements, e.g. a vector or another set.
+ * Repeated elements are kept once.
+ *
+ * Parameters: first - First element
+ *             last  - One past the last element
+ */
+template <class Type, class SetType>
+template <class Iterator>
+DynamicSet<Type, SetType>::DynamicSet(Iterator first, Iterator last)
+	: theSet(first, last)
+{
+	capacity = theSet.maxSize();
 }
 
 /* Copy constructor */
-template <class Type>
-DynamicSet<Type>::DynamicSet(const DynamicSet<Type>& otherSet)
+template <class Type, class SetType>
+DynamicSet<Type, SetType>::DynamicSet(const DynamicSet<Type, SetType>& otherSet)
 {
 	capacity = otherSet.capacity;
 	theSet = otherSet.theSet; // Use Static Set's overloaded =
 }
 
 /* Overloading assignment operator (=) */
-template <class Type>
-const DynamicSet<Type>& DynamicSet<Type>::operator=(const DynamicSet<Type>& otherSet)
+template <class Type, class SetType>
+const DynamicSet<Type, SetType>& DynamicSet<Type, SetType>::operator=(const DynamicSet<Type, SetType>& otherSet)
 {
 	if (this != &otherSet) // Avoid self-assignment
 	{
@@ -77,6 +107,59 @@ const DynamicSet<Type>& DynamicSet<Type>::operator=(const DynamicSet<Type>& othe
 	return *this;
 }
 
+/* Move constructor */
+template <class Type, class SetType>
+DynamicSet<Type, SetType>::DynamicSet(DynamicSet<Type, SetType>&& otherSet)
+	: theSet(std::move(otherSet.theSet))
+{
+	capacity = otherSet.capacity;
+	otherSet.capacity = 0; // otherSet.theSet has no room left either
+}
+
+/* Overloading assignment operator (=) for temporaries */
+template <class Type, class SetType>
+const DynamicSet<Type, SetType>& DynamicSet<Type, SetType>::operator=(DynamicSet<Type, SetType>&& otherSet)
+{
+	if (this != &otherSet)
+	{
+		capacity = otherSet.capacity;
+		theSet = std::move(otherSet.theSet);
+		otherSet.capacity = 0;
+	}
+
+	return *this;
+}
+
+/*
+ * reserve
+ *
+ * Makes room for at least newCapacity elements, so adding that many
+ * doesn't have to grow the set again.
+ *
+ * Parameters: newCapacity - Amount of elements that must fit
+ */
+template <class Type, class SetType>
+void DynamicSet<Type, SetType>::reserve(int newCapacity)
+{
+	if (newCapacity > capacity)
+	{
+		theSet.reserve(newCapacity);
+		capacity = newCapacity;
+	}
+}
+
+/*
+ * shrinkToFit
+ *
+ * Releases the room that isn't used (e.g. after removing many elements).
+ */
+template <class Type, class SetType>
+void DynamicSet<Type, SetType>::shrinkToFit()
+{
+	theSet.shrinkToFit();
+	capacity = theSet.maxSize();
+}
+
 /*
  * add
  *
@@ -84,19 +167,16 @@ const DynamicSet<Type>& DynamicSet<Type>::operator=(const DynamicSet<Type>& othe
  * 
  * Parameters: e - Element to be added to the set
  */
-template <class Type>
-void DynamicSet<Type>::add(const Type& e)
+template <class Type, class SetType>
+void DynamicSet<Type, SetType>::add(const Type& e)
 {
 	/* First, check if there's room */
 	if (theSet.size() == capacity)
 	{
 		/* Set is full, need to "grow"
-		 * New set should hold twice as many elements */
-		Type *setAsArray = theSet.asArray();
-		theSet = StaticSet<Type>(2*capacity); // uses DynamicSet's overloaded =
-		for (int i = 0; i < capacity; i++)
-			theSet.add(setAsArray[i]);
-		capacity *= 2;
+		 * New set should hold twice as many elements. The elements are
+		 * moved over as they are, without checking for duplicates again. */
+		reserve(capacity > 0 ? 2*capacity : 10);
 	}
 	theSet.add(e);
 }
@@ -109,8 +189,8 @@ void DynamicSet<Type>::add(const Type& e)
  * Parameters: e - Element to be removed
  * Returns: true if element was removed, false otherwise
  */
-template <class Type>
-bool DynamicSet<Type>::remove(const Type& e)
+template <class Type, class SetType>
+bool DynamicSet<Type, SetType>::remove(const Type& e)
 {
 	return theSet.remove(e);
 }
@@ -123,8 +203,8 @@ bool DynamicSet<Type>::remove(const Type& e)
  * Parameters: e - Element to be removed
  * Returns: Amount of copies removed (could be 0)
  */
-template <class Type>
-int DynamicSet<Type>::removeAll(const Type& e)
+template <class Type, class SetType>
+int DynamicSet<Type, SetType>::removeAll(const Type& e)
 {
 	return theSet.removeAll(e);
 }
@@ -134,8 +214,8 @@ int DynamicSet<Type>::removeAll(const Type& e)
  *
  * Remove all elements from the set
  */
-template <class Type>
-void DynamicSet<Type>::clear()
+template <class Type, class SetType>
+void DynamicSet<Type, SetType>::clear()
 {
 	theSet.clear();
 }
@@ -148,8 +228,8 @@ void DynamicSet<Type>::clear()
  * Parameters: e - Element to look for
  * Returns: True if the element is in the set, false otherwise
  */
-template <class Type>
-bool DynamicSet<Type>::isElement(const Type& e) const
+template <class Type, class SetType>
+bool DynamicSet<Type, SetType>::isElement(const Type& e) const
 {
 	return theSet.isElement(e);
 }
@@ -161,8 +241,8 @@ bool DynamicSet<Type>::isElement(const Type& e) const
  *
  * Returns: Amount of elements in the set
  */
-template <class Type>
-int DynamicSet<Type>::size() const
+template <class Type, class SetType>
+int DynamicSet<Type, SetType>::size() const
 {
 	return theSet.size();
 }
@@ -174,8 +254,8 @@ int DynamicSet<Type>::size() const
  *
  * Returns: True if the set is empty, false otherwise
  */
-template <class Type>
-bool DynamicSet<Type>::isEmpty() const
+template <class Type, class SetType>
+bool DynamicSet<Type, SetType>::isEmpty() const
 {
 	return theSet.isEmpty();
 }
@@ -183,15 +263,40 @@ bool DynamicSet<Type>::isEmpty() const
 /*
  * asArray
  *
- * Returns: Contents of the set as an array.
- * (Useful due to the lack of an iterator).
+ * Returns: Copy of the contents of the set as an array, which the caller
+ * must delete. To just go through the elements, use begin() and end().
  */
-template <class Type>
-Type* DynamicSet<Type>::asArray() const
+template <class Type, class SetType>
+Type* DynamicSet<Type, SetType>::asArray() const
 {
 	return theSet.asArray();
 }
 
+/*
+ * begin
+ *
+ * Allows going through the set without copying it, e.g.
+ *     for (const Type& e : set)
+ *
+ * Returns: Iterator to the first element
+ */
+template <class Type, class SetType>
+typename DynamicSet<Type, SetType>::const_iterator DynamicSet<Type, SetType>::begin() const
+{
+	return theSet.begin();
+}
+
+/*
+ * end
+ *
+ * Returns: Iterator one past the last element
+ */
+template <class Type, class SetType>
+typename DynamicSet<Type, SetType>::const_iterator DynamicSet<Type, SetType>::end() const
+{
+	return theSet.end();
+}
+
 
 /*
  * operator<<
@@ -202,8 +307,8 @@ Type* DynamicSet<Type>::asArray() const
  *             set - Set to output
  * Returns: Output stream that was used
  */
-template <class Type>
-std::ostream& operator<<(std::ostream& os, const DynamicSet<Type>& set)
+template <class Type, class SetType>
+std::ostream& operator<<(std::ostream& os, const DynamicSet<Type, SetType>& set)
 {
 	return (os << set.theSet); // this invokes operator<< for Static Set
 }
@@ -216,11 +321,12 @@ std::ostream& operator<<(std::ostream& os, const DynamicSet<Type>& set)
  * Parameters: otherSet - Set to perform union with
  * Returns: New set resulting from the union
  */
-template <class Type>
-DynamicSet<Type> DynamicSet<Type>::setunion(const DynamicSet<Type>& otherSet) const
+template <class Type, class SetType>
+DynamicSet<Type, SetType> DynamicSet<Type, SetType>::setunion(const DynamicSet<Type, SetType>& otherSet) const
 {
-	DynamicSet<Type> result(size() + otherSet.size()); // In case all elements are different
+	DynamicSet<Type, SetType> result(1); // Replaced right away
 	result.theSet = theSet.setunion(otherSet.theSet);
+	result.capacity = result.theSet.maxSize();
 	return result;
 }
 
@@ -232,11 +338,12 @@ DynamicSet<Type> DynamicSet<Type>::setunion(const DynamicSet<Type>& otherSet) co
  * Parameters: otherSet - Set to perform intersection with
  * Returns: New set resulting from the intersection
  */
-template <class Type>
-DynamicSet<Type> DynamicSet<Type>::intersection(const DynamicSet<Type>& otherSet) const
+template <class Type, class SetType>
+DynamicSet<Type, SetType> DynamicSet<Type, SetType>::intersection(const DynamicSet<Type, SetType>& otherSet) const
 {
-	DynamicSet<Type> result(theSet.size());
+	DynamicSet<Type, SetType> result(1); // Replaced right away
 	result.theSet = theSet.intersection(otherSet.theSet);
+	result.capacity = result.theSet.maxSize();
 	return result;
 }
 
@@ -248,11 +355,12 @@ DynamicSet<Type> DynamicSet<Type>::intersection(const DynamicSet<Type>& otherSet
  * Parameters: otherSet - Set to perform difference with
  * Returns: New set resulting from the difference
  */
-template <class Type>
-DynamicSet<Type> DynamicSet<Type>::difference(const DynamicSet<Type>& otherSet) const
+template <class Type, class SetType>
+DynamicSet<Type, SetType> DynamicSet<Type, SetType>::difference(const DynamicSet<Type, SetType>& otherSet) const
 {
-	DynamicSet<Type> result(theSet.size());
+	DynamicSet<Type, SetType> result(1); // Replaced right away
 	result.theSet = theSet.difference(otherSet.theSet);
+	result.capacity = result.theSet.maxSize();
 	return result;
 }
 
@@ -264,8 +372,8 @@ DynamicSet<Type> DynamicSet<Type>::difference(const DynamicSet<Type>& otherSet)
  * Parameters: otherSet - The set which might contain this set
  * Returns: True if this set is a subset of otherSet, and false otherwise
  */
-template <class Type>
-bool DynamicSet<Type>::isSubset(const DynamicSet<Type>& otherSet) const
+template <class Type, class SetType>
+bool DynamicSet<Type, SetType>::isSubset(const DynamicSet<Type, SetType>& otherSet) const
 {
 	return theSet.isSubset(otherSet.theSet);
 }
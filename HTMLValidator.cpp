@@ -10,137 +10,461 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <filesystem>
 #include <string.h>
+#include <sstream>
 #include <string>
-#include "LinkedStack.h"
-#include "DynamicSet.h"
+#include <vector>
+#include "ChunkedValidator.h"
+#include "ReportWriter.h"
+#include "Stats.h"
+#include "TagDictionary.h"
+#include "ThreadPool.h"
+#include "ValidationCache.h"
+#include "ValidationServer.h"
+#include "Validator.h"
+#if !defined(_WIN32)
+#include <glob.h>
+#endif
 using namespace std;
 
-int main()
+/*
+ * loadDictionary
+ *
+ * Stores the tags of tags.txt and self-closing.txt in the dictionary.
+ *
+ * Parameters: dictionary - Dictionary to fill
+ */
+void loadDictionary(TagDictionary& dictionary)
 {
-    LinkedStack<string> tags; // Stack to store the non self-closing tags
-    DynamicSet<string> validTags, selfTags; // Two sets to store the valid tags
-    string tag = ""; // Used to store the tags in the Sets and for tag validation later on
-    string currentTag = ""; // Used for traversing the lines in the file, character by character
+    string line = ""; // Used to read the tag files, line by line
 
-    // Store all valid tags in a Set
+    // Store all valid tags in the dictionary
     ifstream valid("tags.txt");
-    while(getline(valid, tag))
-        validTags.add(tag);
+    while(getline(valid, line))
+        dictionary.addTag(line);
     
-    // Store only the self-closing tags in another Set
+    // Mark the self-closing tags in the dictionary
     ifstream selfClosing("self-closing.txt");
-    while(getline(selfClosing, tag))
-        selfTags.add(tag);
-
-    /* 
-     Reset 'tag' if it's going to be used to validate the tags later on.
-     Why? Because 'tag' would already have a tag before storing the characters
-     for validation and the code will not work. 
-    */
-    tag = "";
-
-    int lineNumber = 1; // Keeps track of the current line to make reference when there's an error
-    bool error = false;
-    bool selfclsngError = false;
-    
-    ifstream import("index.html"); // Link with the HTML file
-    if(!import.is_open()) // File doesn't exist, so don't proceed with the program
+    while(getline(selfClosing, line))
+        dictionary.addSelfClosing(line);
+}
+
+/*
+ * loadProfile
+ *
+ * Stores the tags of a vocabulary profile in the dictionary. A profile
+ * has one tag per line, "name" for a container or "name void" for a
+ * self-closing tag, plus "include NAME" to add another profile and
+ * "custom-elements" to accept custom elements; '#' starts a comment.
+ * A NAME with no '/' or '.' is the file profiles/NAME.txt.
+ *
+ * Parameters: dictionary - Dictionary to fill
+ *             name       - Name or path of the profile
+ *             depth      - Profiles that included this one
+ * Returns: True if it was loaded, false (after saying why) otherwise
+ */
+bool loadProfile(TagDictionary& dictionary, const string& name, int depth = 0)
+{
+    string path = (name.find_first_of("/.") == string::npos) ? "profiles/" + name + ".txt" : name;
+    ifstream profile(path);
+    if(!profile)
+    {
+        cerr << "Can't read the profile " << path << "\n";
+        return false;
+    }
+    if(depth > 16) // A profile that includes itself
+    {
+        cerr << "Too many includes at " << path << "\n";
+        return false;
+    }
+
+    string line = "";
+    for(int number = 1; getline(profile, line); number++)
+    {
+        istringstream words(line.substr(0, line.find('#')));
+        string tag, option, extra;
+        if(!(words >> tag))
+            continue; // Blank line or comment
+        words >> option >> extra;
+        if(tag == "include" && !option.empty() && extra.empty())
+        {
+            if(!loadProfile(dictionary, option, depth + 1))
+                return false;
+        }
+        else if(tag == "custom-elements" && option.empty())
+            dictionary.allowCustomElements();
+        else if(option.empty())
+            dictionary.addTag(tag);
+        else if(option == "void" && extra.empty())
+            dictionary.addSelfClosing(tag);
+        else
+        {
+            cerr << path << ":" << number << ": expected \"tag\", \"tag void\", \"include NAME\" or \"custom-elements\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * loadRules
+ *
+ * Compiles the rules of content-model.txt into the dictionary's content
+ * model. Each line is "CHILD in PARENT...", "PARENT only CHILD..." or
+ * "PARENT excludes CHILD..." ("top" stands for outside of every tag);
+ * later lines win. Tags that aren't in the dictionary are skipped, so
+ * the same rules work with any profile.
+ *
+ * Parameters: dictionary - Dictionary with every tag already added
+ *             path       - Rules file
+ * Returns: True if it was loaded, false (after saying why) otherwise
+ */
+bool loadRules(TagDictionary& dictionary, const string& path)
+{
+    ifstream rules(path);
+    if(!rules)
+    {
+        cerr << "Can't read the rules " << path << "\n";
+        return false;
+    }
+    ContentModel& model = dictionary.contentModel();
+    model.resize(dictionary.size());
+    auto idOf = [&dictionary](const string& tag) { // Custom elements have no rules
+        int id = (tag == "top") ? ContentModel::TOP : dictionary.idOf(tag);
+        return (id < dictionary.size()) ? id : TagDictionary::UNKNOWN_ID;
+    };
+
+    string line = "";
+    for(int number = 1; getline(rules, line); number++)
+    {
+        istringstream words(line.substr(0, line.find('#')));
+        string subject, verb;
+        if(!(words >> subject))
+            continue; // Blank line or comment
+        vector<int> others;
+        for(string tag; words >> tag;)
+            if(verb.empty())
+                verb = tag;
+            else if(idOf(tag) != TagDictionary::UNKNOWN_ID || tag == "top")
+                others.push_back(idOf(tag));
+        if(verb != "in" && verb != "only" && verb != "excludes")
+        {
+            cerr << path << ":" << number << ": expected \"CHILD in PARENT...\", \"PARENT only CHILD...\" or \"PARENT excludes CHILD...\"\n";
+            return false;
+        }
+        int id = idOf(subject);
+        if(id == TagDictionary::UNKNOWN_ID && subject != "top")
+            continue; // Not a tag of this dictionary
+        if(verb == "in")
+            model.allowOnlyIn(id, others);
+        else if(verb == "only")
+            model.allowOnly(id, others);
+        else
+            for(int other : others)
+                model.forbid(id, other);
+    }
+    return true;
+}
+
+/*
+ * isHtmlFile
+ *
+ * Parameters: path - Path of a file
+ * Returns: True for .html and .htm files, also compressed (.html.gz, .htm.zst...)
+ */
+bool isHtmlFile(const filesystem::path& path)
+{
+    string extension = path.extension().string();
+    if(extension == ".gz" || extension == ".zst")
+        extension = path.stem().extension().string();
+    return extension == ".html" || extension == ".htm";
+}
+
+/*
+ * collectFiles
+ *
+ * Expands a command-line argument into the HTML files to validate.
+ * A directory gives every .html/.htm file inside it (recursively, also
+ * the compressed ones),
+ * a glob pattern gives the files that match, and anything else is
+ * taken as a file name.
+ *
+ * Parameters: argument - Command-line argument
+ *             files    - Where the file names are added
+ */
+void collectFiles(const string& argument, vector<string>& files)
+{
+    error_code failure;
+    if(filesystem::is_directory(argument, failure))
+    {
+        vector<string> found;
+        for(filesystem::recursive_directory_iterator it(argument, failure), last; !failure && it != last; it.increment(failure))
+            if(it->is_regular_file(failure) && isHtmlFile(it->path()))
+                found.push_back(it->path().string());
+        sort(found.begin(), found.end()); // Directory order isn't deterministic
+        files.insert(files.end(), found.begin(), found.end());
+        return;
+    }
+#if !defined(_WIN32)
+    if(argument.find_first_of("*?[") != string::npos)
+    {
+        glob_t matches;
+        if(glob(argument.c_str(), 0, nullptr, &matches) == 0) // Matches come out sorted
+            for(size_t i = 0; i < matches.gl_pathc; i++)
+                files.push_back(matches.gl_pathv[i]);
+        globfree(&matches);
+        return;
+    }
+#endif
+    files.push_back(argument);
+}
+
+/*
+ * validateBatch
+ *
+ * Validates many files at the same time, one task per file. The results
+ * are printed in the same order as the files, whatever order they finish in.
+ *
+ * Parameters: files      - Files to validate
+ *             dictionary - Tags, shared by all threads (read only)
+ *             threads    - Amount of threads to use
+ *             maxErrors  - Errors to collect per file (1 stops at the first)
+ *             cache      - Results of earlier runs, or null to validate every file
+ *             report     - Where the results are printed
+ * Returns: Amount of files that aren't valid
+ */
+int validateBatch(const vector<string>& files, const TagDictionary& dictionary, int threads, int maxErrors, ValidationCache* cache,
+    ReportWriter& report)
+{
+    vector<ValidationResult> results(files.size());
+    vector<CacheUpdate> updates(cache ? files.size() : 0);
+    {
+        ThreadPool pool(threads);
+        vector<Validator> validators(pool.size(), Validator(dictionary, maxErrors)); // One per worker, reused for every file
+        for(size_t i = 0; i < files.size(); i++)
+            pool.submit([&, i](int worker) {
+                if(cache) // Only read by the workers; updated below
+                    results[i] = cache->validateFile(validators[worker], files[i], updates[i]);
+                else
+                    results[i] = validators[worker].validateFile(files[i].c_str());
+            });
+        pool.wait();
+    }
+    for(size_t i = 0; i < updates.size(); i++)
+        cache->add(updates[i]);
+
+    STATS_PHASE(REPORT);
+    int invalid = 0;
+    for(size_t i = 0; i < files.size(); i++)
     {
-        cout << "\nFile does not exist or has the wrong path\n" << endl;
-        return 0;
+        if(results[i].status != VALID)
+            invalid++;
+        report.add(files[i], results[i]);
     }
+    return invalid;
+}
 
-    // Get the first line and check if it has the starting tag (<!DOCTYPE html>)
-    getline(import, currentTag);
-    if(currentTag == "<!DOCTYPE html>") // First line is correct. Now, go through the rest of the file
+/*
+ * validateSplit
+ *
+ * Validates the files one at a time, each one split into chunks that
+ * are checked by all threads at once. Meant for a few very large files.
+ * The output is the same as validateBatch.
+ *
+ * Parameters: files      - Files to validate
+ *             dictionary - Tags, shared by all threads (read only)
+ *             threads    - Amount of threads to use
+ *             maxErrors  - Errors to collect per file (1 stops at the first)
+ *             cache      - Results of earlier runs, or null to validate every file
+ *             report     - Where the results are printed
+ * Returns: Amount of files that aren't valid
+ */
+int validateSplit(const vector<string>& files, const TagDictionary& dictionary, int threads, int maxErrors, ValidationCache* cache,
+    ReportWriter& report)
+{
+    ThreadPool pool(threads);
+    ChunkedValidator validator(dictionary, pool, maxErrors);
+    int invalid = 0;
+    for(size_t i = 0; i < files.size(); i++)
     {
-        while(getline(import, currentTag) && !error && !selfclsngError)
+        ValidationResult result;
+        if(cache)
         {
-            lineNumber++;
+            CacheUpdate update;
+            result = cache->validateFile(validator, files[i], update);
+            cache->add(update);
+        }
+        else
+            result = validator.validateFile(files[i].c_str());
+        STATS_PHASE(REPORT);
+        if(result.status != VALID)
+            invalid++;
+        report.add(files[i], result);
+    }
+    return invalid;
+}
+
+#if defined(__linux__)
+/* Stops the server on SIGINT and SIGTERM, removing its socket */
+void stopServer(int)
+{
+    ValidationServer::stop();
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    TagDictionary dictionary; // Classifies every valid tag as container or self-closing
+    bool builtinTags = false; // Use the tags compiled into the program instead of the files
+    bool splitFiles = false; // Split every file into chunks instead of one thread per file
+    string statsFormat; // "text" or "json" to report the counters at the end
+    string cacheFile; // Where the results are kept between runs, if anywhere
+    string socketPath; // Serve requests on this Unix socket instead of reading files
+    ReportFormat format = TEXT_REPORT; // How the results are printed
+    vector<string> profiles; // Vocabulary profiles to use instead of the tag files
+    bool checkRules = false; // Check where each tag is against content-model.txt
 
-            // Traverse the string, character by character
-            for(int i = 0; currentTag[i] != '\0'; i++)
+    int threads = ThreadPool::defaultThreads();
+    int maxErrors = 1; // Stop at the first error unless --all is given
+    vector<string> files;
+    bool fileArguments = false; // A file, directory or pattern was given, even if nothing matched
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--builtin") == 0)
+            builtinTags = true;
+        else if(strcmp(argv[i], "--split") == 0) // Each file on every thread, for huge files
+            splitFiles = true;
+        else if(strcmp(argv[i], "--all") == 0) // Report every error in one pass
+            maxErrors = DEFAULT_MAX_ERRORS;
+        else if(strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc)
+            maxErrors = max(atoi(argv[++i]), 1);
+        else if(strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats-json") == 0)
+            statsFormat = (strcmp(argv[i], "--stats") == 0) ? "text" : "json";
+        else if(strcmp(argv[i], "--cache") == 0 && i + 1 < argc) // Skip the files that didn't change
+            cacheFile = argv[++i];
+        else if(strcmp(argv[i], "--serve") == 0 && i + 1 < argc) // Keep running, for many small documents
+            socketPath = argv[++i];
+        else if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc) // e.g. html5,svg,mathml
+        {
+            stringstream names(argv[++i]);
+            for(string name; getline(names, name, ',');)
+                if(!name.empty())
+                    profiles.push_back(name);
+        }
+        else if(strcmp(argv[i], "--rules") == 0) // Which tag may be inside which
+            checkRules = true;
+        else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc) // For other programs to read
+        {
+            if(!ReportWriter::parseFormat(argv[++i], format))
             {
-                // Skips ' ' characters until it meets a '<'
-                if(currentTag[i] == '<')
-                {
-                    /* Go one position forward again, since it's a closing tag to prevent false validation */
-                    i++;
-                    if(currentTag[i] == '/') // It's a closing tag
-                    {
-                        i++; // Go one position forward again
-                        while(currentTag[i] != '>' && currentTag[i] != ' ') 
-                        {
-                            // Store the characters in a string to get the closing tag
-                            tag += currentTag[i];
-                            i++;
-                        }
-                        if(validTags.isElement(tag) && !selfTags.isElement(tag)) // Tag is valid?
-                        {
-                            // If the tag matches with the most recent in the stack, close it
-                            if(tag == tags.top())
-                                tags.pop();
-                            else
-                            {
-                                // Not the correct closing tag
-                                error = true;
-                                break;
-                            }
-                        }
-                        else if(selfTags.isElement(tag)) // Trying to close a self-closing tag
-                        {
-                            selfclsngError = true;
-                            break;
-                        }
-                        else // Tag is not valid nor is correct
-                        {
-                            error = true;
-                            break;
-                        }
-                    }
-                    else // It's not a closing tag
-                    {
-                        while(currentTag[i] != '>' && currentTag[i] != ' ')
-                        {
-                            // Extract the tag to a string variable without spaces or '<>'
-                            tag += currentTag[i];
-                            i++;
-                        }
-                        // It's valid but not a self-closing tag, so a tag has opened
-                        if(validTags.isElement(tag) && !selfTags.isElement(tag))
-                            tags.push(tag);
-                        
-                        // Tag doesn't exist or written incorrectly, so there's an error
-                        if(!validTags.isElement(tag) && !selfTags.isElement(tag))
-                        {
-                            error = true;
-                            break;
-                        }
-                    }
-                }
-                // Reset string variable to avoid mixing or combining tags
-                tag = "";
+                cerr << "Unknown format: " << argv[i] << " (text, jsonl or sarif)\n";
+                return 1;
             }
-    
         }
-        if(error) // There's an invalid or incorrect syntax in the file
-            cout << "\nError in line " << lineNumber << ": Invalid or missing tag with '" << tag << "'\n";
+        else
+        {
+            collectFiles(argv[i], files);
+            fileArguments = true;
+        }
+    }
+
+#ifndef HTMLVALIDATOR_STATS
+    if(!statsFormat.empty())
+        cerr << "Compile with -DHTMLVALIDATOR_STATS to get the counters\n";
+#endif
+    for(const string& file : files)
+    {
+        Compression compression = GZIP_COMPRESSED;
+        if(file.size() > 4 && file.compare(file.size() - 4, 4, ".zst") == 0)
+            compression = ZSTD_COMPRESSED;
+        else if(file.size() <= 3 || file.compare(file.size() - 3, 3, ".gz") != 0)
+            continue;
+        if(!canDecompress(compression)) // They would be reported as files that can't be read
+        {
+            cerr << "Compile with -DHTMLVALIDATOR_WITH_" << (compression == GZIP_COMPRESSED ? "ZLIB" : "ZSTD")
+                 << " to read " << file << "\n";
+            break;
+        }
+    }
+
+    {
+        STATS_PHASE(LOAD_DICTIONARY);
+        if(builtinTags)
+            dictionary.addBuiltin(); // No files to read
+        else if(profiles.empty())
+            loadDictionary(dictionary);
+        for(const string& profile : profiles) // On top of the built-in tags, if asked for
+            if(!loadProfile(dictionary, profile))
+                return 1;
+        if(checkRules && !loadRules(dictionary, "content-model.txt")) // After every tag is in
+            return 1;
+    }
 
-        else if (selfclsngError) // A self-closing tag is trying to get closed
-            cout << "\nError in line " << lineNumber << ": '"<< tag << "' is a self-closing tag\n";
+    if(!socketPath.empty())
+    {
+#if defined(__linux__)
+        signal(SIGINT, stopServer);
+        signal(SIGTERM, stopServer);
+        return ValidationServer(dictionary, threads, maxErrors).run(socketPath.c_str());
+#else
+        cerr << "Server mode is only available on Linux\n";
+        return 1;
+#endif
+    }
 
-        // Opening tags are left unclosed
-        else if(!tags.isEmpty())
-            cout << "Error in line " << lineNumber << ": '" << tags.top() << "' must have its closing tag\n";
-        
-        // All tags are valid and correct with no issues
+    ValidationCache cache(dictionary, maxErrors); // Out of date (and empty) if the tags changed
+    ValidationCache* useCache = nullptr;
+    if(!cacheFile.empty())
+    {
+        cache.load(cacheFile.c_str());
+        useCache = &cache;
+    }
+
+    int status = 0;
+    ReportWriter report(format, maxErrors); // Written out when full and at the end, not per file
+    // No files given: validate index.html, like always
+    if(!fileArguments)
+    {
+        ValidationResult result;
+        CacheUpdate update;
+        if(splitFiles)
+        {
+            ThreadPool pool(threads);
+            ChunkedValidator validator(dictionary, pool, maxErrors);
+            result = useCache ? cache.validateFile(validator, "index.html", update) : validator.validateFile("index.html");
+        }
         else
-            cout << "\nCompiled successfully: HTML file is valid!\n" << endl;
+        {
+            Validator validator(dictionary, maxErrors);
+            result = useCache ? cache.validateFile(validator, "index.html", update) : validator.validateFile("index.html");
+        }
+        if(useCache)
+            cache.add(update);
+        STATS_PHASE(REPORT);
+        report.add("index.html", result, false);
+    }
+    // Batch mode: validate every file, directory or pattern given
+    else if(files.empty())
+    {
+        cout << "No HTML files to validate\n";
+        status = 1;
     }
-    // Tag '<!DOCTYPE html>' is not present in the beginning
+    else if(splitFiles)
+        status = validateSplit(files, dictionary, threads, maxErrors, useCache, report) == 0 ? 0 : 1;
     else
-        cout << "\nError: DOCTYPE must be in line 1\n" << endl;
+        status = validateBatch(files, dictionary, threads, maxErrors, useCache, report) == 0 ? 0 : 1;
+    report.finish();
+
+    if(useCache && !cache.save(cacheFile.c_str()))
+        cerr << "Couldn't save the cache to " << cacheFile << "\n";
 
-    return 0;
+#ifdef HTMLVALIDATOR_STATS
+    if(!statsFormat.empty()) // Away from the results, on the error output
+        Stats::report(cerr, statsFormat == "json");
+#endif
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,603 @@
+/******************************************
+* HashSet.h
+*
+* Hashed Set class (using templates).
+* Same interface as StaticSet, but elements are
+* stored in an open-addressing table so that
+* isElement runs in O(1) instead of O(n).
+*
+* Author: Gustavo A. Rassi
+******************************************/
+
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <iostream>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+template <class Type>
+class HashSet
+{
+	template <class T>
+	friend std::ostream& operator<<(std::ostream&, const HashSet<T>&);
+
+	public:
+		class const_iterator; // goes through the used slots
+
+		HashSet(int = DEFAULTAMT); // constructor with default parameter
+		template <class Iterator>
+		HashSet(Iterator, Iterator); // constructor from a range of elements
+		HashSet(const HashSet<Type> &); // Copy constructor
+		HashSet(HashSet<Type> &&); // Move constructor
+		const HashSet<Type>& operator=(const HashSet<Type> &); // Overload =
+		const HashSet<Type>& operator=(HashSet<Type> &&); // Overload = (move)
+		~HashSet(); // destructor
+
+		void reserve(int); // make room for more elements
+		void shrinkToFit(); // release the room that isn't used
+		int maxSize() const; // amount of elements that fit
+		void add(const Type &);
+		bool remove(const Type &); // remove a single copy
+		int removeAll(const Type &); // remove ALL copies
+		void clear();
+		bool isElement(const Type &) const;
+		int size() const; // amount of elements
+		bool isEmpty() const;
+		Type* asArray() const;
+		const_iterator begin() const; // first element (no particular order)
+		const_iterator end() const; // one past the last element
+		HashSet<Type> setunion(const HashSet<Type> &) const;
+		HashSet<Type> intersection(const HashSet<Type> &) const;
+		HashSet<Type> difference(const HashSet<Type> &) const;
+		bool isSubset(const HashSet<Type> &) const;
+	private:
+		int findSlot(const Type &) const; // slot holding e, or -1
+		void copySet(const HashSet<Type> &); // Used by copy constructor and operator=
+		void moveSet(HashSet<Type> &); // Used by move constructor and operator=
+		void rebuild(int); // move every element to a table of another size
+
+		int currentSize, capacity;
+		int mask; // amount of slots - 1 (amount of slots is a power of 2)
+		Type *slots;
+		bool *used; // used[i] is true if slots[i] holds an element
+		static const int DEFAULTAMT = 10;
+};
+
+/* Iterator over the elements of a HashSet. It skips the empty slots,
+ * so going through the set takes O(capacity) and allocates nothing. */
+template <class Type>
+class HashSet<Type>::const_iterator
+{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Type* pointer;
+		typedef const Type& reference;
+
+		const_iterator(const HashSet<Type>* s = nullptr, int i = 0) : set(s), slot(i) { skipEmpty(); }
+		reference operator*() const { return set->slots[slot]; }
+		pointer operator->() const { return &set->slots[slot]; }
+		const_iterator& operator++() { slot++; skipEmpty(); return *this; }
+		const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; }
+		bool operator==(const const_iterator& other) const { return slot == other.slot; }
+		bool operator!=(const const_iterator& other) const { return slot != other.slot; }
+	private:
+		void skipEmpty() { while (set != nullptr && slot <= set->mask && !set->used[slot]) slot++; }
+
+		const HashSet<Type> *set;
+		int slot; // mask + 1 at the end
+};
+
+/* Implementation included in the same file due to the use of templates. */
+
+/* Constructor */
+template <class Type>
+HashSet<Type>::HashSet(int initialCapacity)
+{
+	if (initialCapacity < 1) // Make sure we get a valid number
+		initialCapacity = DEFAULTAMT;
+	capacity = initialCapacity;
+	/* Keep the table at most half full so probe sequences stay short */
+	int amtSlots = 1;
+	while (amtSlots < 2 * capacity)
+		amtSlots *= 2;
+	mask = amtSlots - 1;
+	slots = new Type[amtSlots];
+	used = new bool[amtSlots]();
+	currentSize = 0; // Set is initially empty
+}
+
+/*
+ * Constructor
+ *
+ * Builds the set from a range of elements, e.g. a vector or another set.
+ * Repeated elements are kept once. The table doubles whenever it fills
+ * up, so this takes O(n) no matter how long the range is.
+ *
+ * Parameters: first - First element
+ *             last  - One past the last element
+ */
+template <class Type>
+template <class Iterator>
+HashSet<Type>::HashSet(Iterator first, Iterator last)
+	: HashSet(DEFAULTAMT)
+{
+	for (; first != last; ++first)
+	{
+		if (currentSize == capacity)
+			rebuild(2 * capacity);
+		add(*first);
+	}
+}
+
+/* Copy constructor */
+template <class Type>
+HashSet<Type>::HashSet(const HashSet<Type>& otherSet)
+{
+	copySet(otherSet);
+}
+
+/* Overloading assignment operator (=) */
+template <class Type>
+const HashSet<Type>& HashSet<Type>::operator=(const HashSet<Type>& otherSet)
+{
+	if (this != &otherSet) // Avoid self-assignment
+	{
+		delete [] slots;
+		delete [] used;
+		copySet(otherSet);
+	}
+
+	return *this;
+}
+
+/*
+ * copySet
+ *
+ * Make this set a copy of another set. The table layout is copied as is,
+ * so there's no need to rehash any element.
+ */
+template <class Type>
+void HashSet<Type>::copySet(const HashSet<Type>& otherSet)
+{
+	currentSize = otherSet.currentSize;
+	capacity = otherSet.capacity;
+	mask = otherSet.mask;
+	slots = new Type[mask + 1];
+	used = new bool[mask + 1];
+	for (int i = 0; i <= mask; i++)
+	{
+		used[i] = otherSet.used[i];
+		if (used[i])
+			slots[i] = otherSet.slots[i];
+	}
+}
+
+/* Move constructor */
+template <class Type>
+HashSet<Type>::HashSet(HashSet<Type>&& otherSet)
+{
+	moveSet(otherSet);
+}
+
+/* Overloading assignment operator (=) for temporaries */
+template <class Type>
+const HashSet<Type>& HashSet<Type>::operator=(HashSet<Type>&& otherSet)
+{
+	if (this != &otherSet)
+	{
+		delete [] slots;
+		delete [] used;
+		moveSet(otherSet);
+	}
+
+	return *this;
+}
+
+/*
+ * moveSet
+ *
+ * Take the table of another set instead of copying it. otherSet is left
+ * empty, with no room (adding to it does nothing).
+ */
+template <class Type>
+void HashSet<Type>::moveSet(HashSet<Type>& otherSet)
+{
+	currentSize = otherSet.currentSize;
+	capacity = otherSet.capacity;
+	mask = otherSet.mask;
+	slots = otherSet.slots;
+	used = otherSet.used;
+	otherSet.currentSize = 0;
+	otherSet.capacity = 0;
+	otherSet.mask = -1; // no slots at all
+	otherSet.slots = nullptr;
+	otherSet.used = nullptr;
+}
+
+/* Destructor */
+template <class Type>
+HashSet<Type>::~HashSet()
+{
+	delete [] slots; // Avoid memory leak
+	delete [] used;
+}
+
+/*
+ * rebuild
+ *
+ * Moves every element to a new table sized for newCapacity elements.
+ * Elements are already known to be different, so they're placed in
+ * the first free slot without comparing them.
+ *
+ * Parameters: newCapacity - Amount of elements that must fit
+ */
+template <class Type>
+void HashSet<Type>::rebuild(int newCapacity)
+{
+	int amtSlots = 1;
+	while (amtSlots < 2 * newCapacity)
+		amtSlots *= 2;
+	Type *newSlots = new Type[amtSlots];
+	bool *newUsed = new bool[amtSlots]();
+	int newMask = amtSlots - 1;
+	for (int i = 0; i <= mask; i++)
+		if (used[i])
+		{
+			int j = (int)(std::hash<Type>()(slots[i]) & (size_t)newMask);
+			while (newUsed[j])
+				j = (j + 1) & newMask;
+			newSlots[j] = std::move(slots[i]);
+			newUsed[j] = true;
+		}
+	delete [] slots;
+	delete [] used;
+	slots = newSlots;
+	used = newUsed;
+	mask = newMask;
+	capacity = newCapacity;
+}
+
+/*
+ * reserve
+ *
+ * Grows the table so it can hold at least newCapacity elements.
+ *
+ * Parameters: newCapacity - Amount of elements that must fit
+ */
+template <class Type>
+void HashSet<Type>::reserve(int newCapacity)
+{
+	if (newCapacity > capacity)
+		rebuild(newCapacity);
+}
+
+/*
+ * shrinkToFit
+ *
+ * Shrinks the table to the amount of elements (at least 1).
+ */
+template <class Type>
+void HashSet<Type>::shrinkToFit()
+{
+	int newCapacity = currentSize > 0 ? currentSize : 1;
+	if (newCapacity != capacity)
+		rebuild(newCapacity);
+}
+
+/*
+ * maxSize
+ *
+ * Returns: Amount of elements that fit before the set is full
+ */
+template <class Type>
+int HashSet<Type>::maxSize() const
+{
+	return capacity;
+}
+
+/*
+ * findSlot
+ *
+ * Locates the slot that holds an element using linear probing.
+ *
+ * Parameters: e - Element to look for
+ * Returns: Index of the slot holding e, or -1 if e isn't in the set
+ */
+template <class Type>
+int HashSet<Type>::findSlot(const Type& e) const
+{
+	if (slots == nullptr) // moved-from set
+		return -1;
+	int i = (int)(std::hash<Type>()(e) & (size_t)mask);
+	/* The table is never full, so an empty slot always ends the search */
+	while (used[i])
+	{
+		if (slots[i] == e)
+			return i;
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+/*
+ * add
+ *
+ * Add an element to the set if there's room and if it's not already present.
+ *
+ * Parameters: e - Element to be added to the set
+ */
+template <class Type>
+void HashSet<Type>::add(const Type& e)
+{
+	if (currentSize == capacity)
+		return;
+	int i = (int)(std::hash<Type>()(e) & (size_t)mask);
+	while (used[i])
+	{
+		if (slots[i] == e) // Already there
+			return;
+		i = (i + 1) & mask;
+	}
+	slots[i] = e;
+	used[i] = true;
+	currentSize++;
+}
+
+/*
+ * remove
+ *
+ * Remove the element from the set if it's there.
+ *
+ * Parameters: e - Element to be removed
+ * Returns: true if element was removed, false otherwise
+ */
+template <class Type>
+bool HashSet<Type>::remove(const Type& e)
+{
+	int hole = findSlot(e);
+	if (hole == -1)
+		return false;
+
+	/* Shift back the elements that follow in the same cluster, so lookups
+	 * never stop early at the hole we just made (no tombstones needed). */
+	int i = hole;
+	while (true)
+	{
+		i = (i + 1) & mask;
+		if (!used[i])
+			break;
+		int home = (int)(std::hash<Type>()(slots[i]) & (size_t)mask);
+		/* Move slots[i] only if its home isn't cyclically in (hole, i] */
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			slots[hole] = std::move(slots[i]);
+			hole = i;
+		}
+	}
+	slots[hole] = Type();
+	used[hole] = false;
+	currentSize--;
+	return true;
+}
+
+/*
+ * removeAll
+ *
+ * Remove from the set all copies of an element.
+ *
+ * Parameters: e - Element to be removed
+ * Returns: Amount of copies removed (could be 0)
+ */
+template <class Type>
+int HashSet<Type>::removeAll(const Type& e)
+{
+	int counter = 0;
+	while (remove(e))
+		counter++;
+	return counter;
+}
+
+/*
+ * clear
+ *
+ * Remove all elements from the set
+ */
+template <class Type>
+void HashSet<Type>::clear()
+{
+	for (int i = 0; i <= mask; i++)
+		if (used[i])
+		{
+			slots[i] = Type();
+			used[i] = false;
+		}
+	currentSize = 0;
+}
+
+/*
+ * isElement
+ *
+ * Determines if an element is present in the set.
+ *
+ * Parameters: e - Element to look for
+ * Returns: True if the element is in the set, false otherwise
+ */
+template <class Type>
+bool HashSet<Type>::isElement(const Type& e) const
+{
+	return findSlot(e) != -1;
+}
+
+/*
+ * size
+ *
+ * Determines the amount of elements in the set.
+ *
+ * Returns: Amount of elements in the set
+ */
+template <class Type>
+int HashSet<Type>::size() const
+{
+	return currentSize;
+}
+
+/*
+ * isEmpty
+ *
+ * Determines whether the set is empty.
+ *
+ * Returns: True if the set is empty, false otherwise
+ */
+template <class Type>
+bool HashSet<Type>::isEmpty() const
+{
+	return (currentSize == 0);
+}
+
+/*
+ * asArray
+ *
+ * Returns: Copy of the contents of the set as an array (in no particular
+ * order), which the caller must delete. To just go through the elements,
+ * use begin() and end().
+ */
+template <class Type>
+Type* HashSet<Type>::asArray() const
+{
+	Type *elementsCopy = new Type[currentSize];
+	int j = 0;
+
+	for (const Type& e : *this)
+		elementsCopy[j++] = e;
+	return elementsCopy;
+}
+
+/*
+ * begin
+ *
+ * Allows going through the set without copying it, e.g.
+ *     for (const Type& e : set)
+ *
+ * Returns: Iterator to the first element
+ */
+template <class Type>
+typename HashSet<Type>::const_iterator HashSet<Type>::begin() const
+{
+	return const_iterator(this, 0);
+}
+
+/*
+ * end
+ *
+ * Returns: Iterator one past the last element
+ */
+template <class Type>
+typename HashSet<Type>::const_iterator HashSet<Type>::end() const
+{
+	return const_iterator(this, mask + 1);
+}
+
+/*
+ * operator<<
+ *
+ * Overload the << operator to output the set using an output stream.
+ *
+ * Parameters: os  - Output stream to use
+ *             set - Set to output
+ * Returns: Output stream that was used
+ */
+template <class Type>
+std::ostream& operator<<(std::ostream& os, const HashSet<Type>& set)
+{
+	for (const Type& e : set)
+		os << e << " ";
+	os << "\n";
+
+	return os;
+}
+
+/*
+ * setunion
+ *
+ * Perform the union operation with the specified set.
+ *
+ * Parameters: otherSet - Set to perform union with
+ * Returns: New set resulting from the union
+ */
+template <class Type>
+HashSet<Type> HashSet<Type>::setunion(const HashSet<Type>& otherSet) const
+{
+	/* Room for both sets from the start (in case all elements are
+	 * different), so each element is hashed once and never moved again */
+	HashSet<Type> result(size() + otherSet.size());
+	for (const Type& e : *this)
+		result.add(e);
+	for (const Type& e : otherSet)
+		result.add(e); // add() will avoid duplicates
+	return result;
+}
+
+/*
+ * intersection
+ *
+ * Perform the intersection operation with the specified set.
+ *
+ * Parameters: otherSet - Set to perform intersection with
+ * Returns: New set resulting from the intersection
+ */
+template <class Type>
+HashSet<Type> HashSet<Type>::intersection(const HashSet<Type>& otherSet) const
+{
+	/* Walk the smaller set and look its elements up in the bigger one */
+	const HashSet<Type>& smaller = size() <= otherSet.size() ? *this : otherSet;
+	const HashSet<Type>& bigger = size() <= otherSet.size() ? otherSet : *this;
+	HashSet<Type> result(smaller.size());
+	for (const Type& e : smaller)
+		if (bigger.isElement(e))
+			result.add(e);
+	return result;
+}
+
+/*
+ * difference
+ *
+ * Perform the difference operation with the specified set.
+ *
+ * Parameters: otherSet - Set to perform difference with
+ * Returns: New set resulting from the difference
+ */
+template <class Type>
+HashSet<Type> HashSet<Type>::difference(const HashSet<Type>& otherSet) const
+{
+	HashSet<Type> result(size()); // New set can't be bigger than current set
+	for (const Type& e : *this)
+		if (!otherSet.isElement(e))
+			result.add(e);
+	return result;
+}
+
+/*
+ * isSubset
+ *
+ * Determine if set is a subset of another set.
+ *
+ * Parameters: otherSet - The set which might contain this set
+ * Returns: True if this set is a subset of otherSet, and false otherwise
+ */
+template <class Type>
+bool HashSet<Type>::isSubset(const HashSet<Type>& otherSet) const
+{
+	if (size() > otherSet.size()) // Can't all be there
+		return false;
+	for (const Type& e : *this)
+		if (!otherSet.isElement(e))
+			return false;
+	return true;
+}
+
+#endif
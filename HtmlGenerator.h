@@ -0,0 +1,319 @@
+/*****************************************************
+ * HtmlGenerator.h
+ *
+ * Makes up HTML documents of any size for testing
+ * and benchmarking. The tags are drawn from a
+ * TagDictionary, and everything comes from a seeded
+ * random number generator of our own, so the same
+ * options give the same bytes on every machine.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef HTMLGENERATOR_H
+#define HTMLGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TagDictionary.h"
+
+struct GeneratorOptions
+{
+	std::size_t bytes = 1 << 20; // about how big the document gets
+	int maxDepth = 12; // deepest nesting of container tags
+	double errorRate = 0; // chance of a tag being an error instead
+	double attributeRate = 0.3; // chance of a tag having attributes
+	bool minified = false; // no line breaks or indentation
+	std::uint64_t seed = 1;
+};
+
+class HtmlGenerator
+{
+	public:
+		HtmlGenerator(const TagDictionary&, const GeneratorOptions& = GeneratorOptions());
+
+		std::string generate(); // make a whole document
+		long long tagsMade() const; // tags in the last document
+		long long errorsMade() const; // errors put in the last document
+	private:
+		std::uint64_t nextRandom(); // next number of the sequence
+		int randomBelow(int); // 0 to n - 1
+		bool chance(double); // true with that probability
+
+		void newLine(std::string&); // line break and indentation
+		void attributes(std::string&); // zero or more attributes
+		void openTag(std::string&, const std::string&);
+		void closeTag(std::string&, const std::string&);
+		void text(std::string&);
+		void error(std::string&); // a tag the validator must reject
+
+		const TagDictionary& dictionary;
+		GeneratorOptions options;
+		std::uint64_t state;
+		std::vector<int> containers; // IDs of the tags that may hold other tags
+		std::vector<int> rawText; // IDs of script, style and the like
+		std::vector<int> selfClosing;
+		std::vector<int> open; // IDs of the tags open at this point
+		long long tags, errors;
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Tags to choose from
+ *             settings      - Size, shape and seed of the documents
+ */
+inline HtmlGenerator::HtmlGenerator(const TagDictionary& tagDictionary, const GeneratorOptions& settings)
+	: dictionary(tagDictionary), options(settings)
+{
+	state = options.seed;
+	tags = errors = 0;
+	for (int id = 0; id < dictionary.size(); id++)
+	{
+		const std::string& name = dictionary.nameOf(id);
+		if (dictionary.kindOf(id) == SELF_CLOSING_TAG)
+			selfClosing.push_back(id);
+		else if (name == "script" || name == "style" || name == "textarea" || name == "title")
+			rawText.push_back(id); // Only text goes inside them
+		else if (name != "html" && name != "head" && name != "body")
+			containers.push_back(id);
+	}
+}
+
+/*
+ * nextRandom
+ *
+ * SplitMix64. Unlike the distributions of <random>, it gives the same
+ * numbers with every compiler.
+ *
+ * Returns: Next 64-bit number
+ */
+inline std::uint64_t HtmlGenerator::nextRandom()
+{
+	std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/*
+ * randomBelow
+ *
+ * Parameters: n - Amount of possible values (at least 1)
+ * Returns: Number from 0 to n - 1
+ */
+inline int HtmlGenerator::randomBelow(int n)
+{
+	return (int)(nextRandom() % (std::uint64_t)n);
+}
+
+/*
+ * chance
+ *
+ * Parameters: probability - From 0 (never) to 1 (always)
+ * Returns: True with that probability
+ */
+inline bool HtmlGenerator::chance(double probability)
+{
+	return (nextRandom() >> 11) * (1.0 / 9007199254740992.0) < probability;
+}
+
+/*
+ * newLine
+ *
+ * Starts a new line indented to the current depth, unless the
+ * document is minified.
+ */
+inline void HtmlGenerator::newLine(std::string& out)
+{
+	if (options.minified)
+		return;
+	out += '\n';
+	out.append(2 * open.size(), ' ');
+}
+
+/*
+ * attributes
+ *
+ * Adds attributes the way real pages have them: some in double quotes,
+ * some in single quotes with '"' or '>' inside, some without quotes
+ * (with a "'" that doesn't start a value), some without a value.
+ */
+inline void HtmlGenerator::attributes(std::string& out)
+{
+	while (chance(options.attributeRate))
+		switch (randomBelow(7))
+		{
+			case 0:
+				out += " class=\"c" + std::to_string(randomBelow(100)) + "\"";
+				break;
+			case 1:
+				out += " id=\"n" + std::to_string(randomBelow(100000)) + "\"";
+				break;
+			case 2:
+				out += " href=\"/p?q=1&amp;r=2\"";
+				break;
+			case 3:
+				out += " data-x='{\"a\":1,\"b\":\"x>y\"}'";
+				break;
+			case 4:
+				out += " hidden";
+				break;
+			case 5:
+				out += " alt=Don't";
+				break;
+			case 6:
+				out += " title = \"a > b\"";
+				break;
+		}
+}
+
+inline void HtmlGenerator::openTag(std::string& out, const std::string& name)
+{
+	out += '<';
+	out += name;
+	attributes(out);
+	out += '>';
+	tags++;
+}
+
+inline void HtmlGenerator::closeTag(std::string& out, const std::string& name)
+{
+	out += "</";
+	out += name;
+	out += '>';
+	tags++;
+}
+
+/*
+ * text
+ *
+ * Adds some words, and now and then a few character references.
+ */
+inline void HtmlGenerator::text(std::string& out)
+{
+	static const char *WORDS[] = {"lorem", "ipsum", "dolor", "sit", "amet", "report", "total", "value"};
+	int amount = 1 + randomBelow(12);
+	for (int i = 0; i < amount; i++)
+	{
+		if (!out.empty() && out.back() != '>' && out.back() != ' ' && out.back() != '\n')
+			out += ' ';
+		out += WORDS[randomBelow(8)];
+	}
+	if (chance(0.05))
+		out += " &amp; a &lt; b";
+}
+
+/*
+ * error
+ *
+ * Adds one tag that makes the document invalid: an unknown tag, a
+ * closed self-closing tag or a closing tag that doesn't match.
+ */
+inline void HtmlGenerator::error(std::string& out)
+{
+	errors++;
+	int kind = randomBelow(3);
+	if (kind == 1 && !selfClosing.empty())
+		closeTag(out, dictionary.nameOf(selfClosing[randomBelow((int)selfClosing.size())]));
+	else if (kind == 2 && !containers.empty())
+	{
+		int id = containers[randomBelow((int)containers.size())];
+		if (!open.empty() && id == open.back()) // That one would match
+			openTag(out, "bogus-tag");
+		else
+			closeTag(out, dictionary.nameOf(id));
+	}
+	else
+		openTag(out, "bogus-tag");
+}
+
+/*
+ * generate
+ *
+ * Makes a document of about options.bytes bytes. It's valid unless the
+ * error rate says otherwise.
+ *
+ * Returns: The document
+ */
+inline std::string HtmlGenerator::generate()
+{
+	std::string out;
+	out.reserve(options.bytes + 4096);
+	out += "<!DOCTYPE html>\n<html>";
+	open.clear();
+	tags = 1;
+	errors = 0;
+
+	while (out.size() < options.bytes)
+	{
+		if (chance(options.errorRate))
+		{
+			error(out);
+			continue;
+		}
+		int roll = randomBelow(100);
+		if (roll < 35 && (int)open.size() < options.maxDepth && !containers.empty())
+		{
+			newLine(out);
+			int id = containers[randomBelow((int)containers.size())];
+			openTag(out, dictionary.nameOf(id));
+			open.push_back(id);
+		}
+		else if (roll < 55 && !open.empty())
+		{
+			int id = open.back();
+			open.pop_back();
+			newLine(out);
+			closeTag(out, dictionary.nameOf(id));
+		}
+		else if (roll < 65 && !selfClosing.empty())
+			openTag(out, dictionary.nameOf(selfClosing[randomBelow((int)selfClosing.size())]));
+		else if (roll < 67 && !rawText.empty())
+		{
+			const std::string& name = dictionary.nameOf(rawText[randomBelow((int)rawText.size())]);
+			openTag(out, name);
+			out += "if (a<b) { s = '<p>'; }";
+			closeTag(out, name);
+		}
+		else if (roll < 69)
+			out += "<!-- <div> is not a tag here -->";
+		else
+			text(out);
+	}
+
+	while (!open.empty()) // Close everything that's left
+	{
+		int id = open.back();
+		open.pop_back();
+		newLine(out);
+		closeTag(out, dictionary.nameOf(id));
+	}
+	out += "\n</html>\n";
+	tags++;
+	return out;
+}
+
+/*
+ * tagsMade
+ *
+ * Returns: Amount of tags (opening and closing) in the last document
+ */
+inline long long HtmlGenerator::tagsMade() const
+{
+	return tags;
+}
+
+/*
+ * errorsMade
+ *
+ * Returns: Amount of tags that are errors in the last document
+ */
+inline long long HtmlGenerator::errorsMade() const
+{
+	return errors;
+}
+
+#endif
@@ -0,0 +1,567 @@
+/*****************************************************
+ * IncrementalValidator.h
+ *
+ * Validates a document that keeps being edited, e.g.
+ * in an editor. The state at the start of every line
+ * (the open tags and where the tokenizer is) is kept,
+ * so after an edit only the edited lines are read
+ * again, and then the lines after them until the
+ * state is the same as before the edit. From there
+ * on, nothing can come out differently.
+ *
+ * The open tags are kept as a linked stack whose
+ * nodes are shared: pushing the same tag on the same
+ * stack always gives the same node. A whole stack is
+ * then a single number, cheap to keep for every line
+ * and to compare. Custom elements, which all have the
+ * same ID in the dictionary, get an ID per name for
+ * as long as the document is loaded.
+ *
+ * The errors are the same as the ones Validator
+ * finds in the whole document.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef INCREMENTALVALIDATOR_H
+#define INCREMENTALVALIDATOR_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "AsciiCase.h"
+#include "Stats.h"
+#include "TagDictionary.h"
+#include "Tokenizer.h"
+#include "Validator.h"
+
+class IncrementalValidator
+{
+	public:
+		IncrementalValidator(const TagDictionary&, int = DEFAULT_MAX_ERRORS); // constructor
+
+		void load(std::string_view); // validate a whole new document
+		void replaceLines(int, int, std::string_view); // edit some lines and validate again
+		ValidationResult result(); // errors of the current document
+		std::string text() const; // the current document
+		int lineCount() const;
+		int linesRead() const; // lines read by the last load or edit
+	private:
+		struct OpenTag
+		{
+			int id; // ID of the tag in the dictionary, or from tagId for a custom element
+			int below; // node of the tags opened before it
+			int depth; // amount of open tags, counting this one
+		};
+
+		struct LineState
+		{
+			Tokenizer::Checkpoint tokenizer; // where the tokenizer is when the line starts
+			int openTags; // node of the tags open when the line starts
+			int lowest; // fewest open tags at any point of the line
+		};
+
+		int tagId(const Token&); // ID of a tag in the stack
+		bool sameTag(int, int) const; // do two IDs from tagId close each other?
+		const std::string& nameOf(int) const; // name of a tag with an ID from tagId
+		int push(int, int); // node for a tag opened on top of a stack
+		void closeTag(int&, const Token&, Tokenizer&, std::vector<ValidationError>&);
+		void readLine(int, Tokenizer&, int&, int&, std::vector<ValidationError>&, std::vector<int>* = nullptr);
+		void readFrom(int, int); // read lines until the state is the same as before
+		bool checkFirstLine() const; // true if line 1 is <!DOCTYPE html>
+		void unclosedTags(std::vector<ValidationError>&); // errors for the tags left open
+		template <class Item>
+		static void replaceRange(std::vector<Item>&, int, int, std::vector<Item>&);
+
+		const TagDictionary& dictionary;
+		int maxErrors;
+		std::vector<std::string> lines; // text of every line, with its '\n'
+		std::vector<LineState> states; // one per line, plus the end of the document
+		std::vector<std::vector<ValidationError>> lineErrors; // errors of each line, without the line number
+		std::vector<OpenTag> nodes; // node 0 is the empty stack
+		std::unordered_map<std::uint64_t, int> nodeOf; // node by (below, id)
+		std::deque<std::string> customNames; // custom elements in the document, by ID - CUSTOM_ID - 1
+		std::unordered_map<std::string_view, int> customIds; // keys point into customNames
+		std::vector<int> errorLines; // lines with errors, in order
+		int readCount; // lines read by the last change
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Tags to validate against
+ *             errorLimit    - Amount of errors to report (1 gives the
+ *                             same result as a Validator that stops at
+ *                             the first error)
+ */
+inline IncrementalValidator::IncrementalValidator(const TagDictionary& tagDictionary, int errorLimit)
+	: dictionary(tagDictionary)
+{
+	maxErrors = errorLimit < 1 ? 1 : errorLimit;
+	load(std::string_view());
+}
+
+/*
+ * tagId
+ *
+ * Every spelling of a custom element gets its own ID after CUSTOM_ID,
+ * kept until the next load, so a node can tell them apart and errors
+ * name them the way Validator does.
+ *
+ * Parameters: token - A tag
+ * Returns: ID of the tag, to keep in a node
+ */
+inline int IncrementalValidator::tagId(const Token& token)
+{
+	if (token.id != TagDictionary::CUSTOM_ID)
+		return token.id;
+	auto found = customIds.find(token.name);
+	if (found != customIds.end())
+		return found->second;
+	customNames.emplace_back(token.name);
+	int id = TagDictionary::CUSTOM_ID + (int)customNames.size();
+	customIds.emplace(customNames.back(), id);
+	return id;
+}
+
+/*
+ * sameTag
+ *
+ * Parameters: open    - ID of an open tag
+ *             closing - ID of a closing tag
+ * Returns: True if the closing tag closes the open one (custom
+ *          elements in any case, like the other tags)
+ */
+inline bool IncrementalValidator::sameTag(int open, int closing) const
+{
+	if (open == closing)
+		return true;
+	return open > TagDictionary::CUSTOM_ID && closing > TagDictionary::CUSTOM_ID
+		&& AsciiCase::equalsAnyCase(nameOf(open), nameOf(closing));
+}
+
+/*
+ * nameOf
+ *
+ * Parameters: id - ID of a tag, from tagId
+ * Returns: Name of the tag
+ */
+inline const std::string& IncrementalValidator::nameOf(int id) const
+{
+	if (id > TagDictionary::CUSTOM_ID)
+		return customNames[id - TagDictionary::CUSTOM_ID - 1];
+	return dictionary.nameOf(id);
+}
+
+/*
+ * push
+ *
+ * Parameters: below - Node of the stack
+ *             id    - Tag being opened
+ * Returns: Node of the stack with the tag on top
+ */
+inline int IncrementalValidator::push(int below, int id)
+{
+	std::uint64_t key = ((std::uint64_t)(std::uint32_t)below << 32) | (std::uint32_t)id;
+	auto found = nodeOf.find(key);
+	if (found != nodeOf.end())
+		return found->second;
+	nodes.push_back({id, below, nodes[below].depth + 1});
+	nodeOf.emplace(key, (int)nodes.size() - 1);
+	return (int)nodes.size() - 1;
+}
+
+/*
+ * closeTag
+ *
+ * Same as Validator::closeTag, with the same recovery from errors.
+ *
+ * Parameters: openTags  - Node of the open tags; changed by the tag
+ *             token     - The closing tag
+ *             tokenizer - Tokenizer that found it, for its column
+ *             errors    - Where an error is added
+ */
+inline void IncrementalValidator::closeTag(int& openTags, const Token& token, Tokenizer& tokenizer,
+	std::vector<ValidationError>& errors)
+{
+	int id = tagId(token);
+	if (openTags != 0 && sameTag(nodes[openTags].id, id))
+	{
+		openTags = nodes[openTags].below;
+		STATS_COUNT(POPS);
+		return;
+	}
+
+	errors.push_back({MISMATCHED_TAG, 0, tokenizer.columnOf(token), std::string(token.name),
+		openTags == 0 ? std::string() : nameOf(nodes[openTags].id)});
+
+	// Recovery: pop to the nearest matching ancestor, if there's one
+	for (int node = nodes[openTags].below; node != 0; node = nodes[node].below)
+		if (sameTag(nodes[node].id, id))
+		{
+			STATS_ADD(POPS, nodes[openTags].depth - nodes[node].depth + 1);
+			openTags = nodes[node].below;
+			return;
+		}
+}
+
+/*
+ * readLine
+ *
+ * Reads the tags of one line (from line 2 on), the way
+ * Validator::checkTags does.
+ *
+ * Parameters: number    - Line to read
+ *             tokenizer - Tokenizer at the start of the line
+ *             openTags  - Node of the open tags; changed by the line
+ *             lowest    - Where the fewest open tags during the line go
+ *             errors    - Where the errors of the line go
+ *             pushed    - If given, the column of the last tag opened at
+ *                         each depth goes here (index = depth)
+ */
+inline void IncrementalValidator::readLine(int number, Tokenizer& tokenizer, int& openTags, int& lowest,
+	std::vector<ValidationError>& errors, std::vector<int>* pushed)
+{
+	const std::string& line = lines[number - 1];
+	tokenizer.feed(line.data(), line.data() + line.size(), number == lineCount());
+	lowest = nodes[openTags].depth;
+	errors.clear();
+
+	Token token;
+	while (tokenizer.next(token))
+	{
+		TagKind kind = dictionary.kindOf(token.id);
+		if (token.closing)
+		{
+			if (kind == CONTAINER_TAG)
+				closeTag(openTags, token, tokenizer, errors);
+			else if (kind == SELF_CLOSING_TAG)
+				errors.push_back({CLOSED_SELF_CLOSING, 0, tokenizer.columnOf(token), std::string(token.name), ""});
+			else
+				errors.push_back({INVALID_TAG, 0, tokenizer.columnOf(token), std::string(token.name), ""});
+			lowest = std::min(lowest, nodes[openTags].depth);
+		}
+		else if (kind == UNKNOWN_TAG)
+			errors.push_back({INVALID_TAG, 0, tokenizer.columnOf(token), std::string(token.name), ""});
+		else
+		{
+			int parent = nodes[openTags].depth == 0 ? ContentModel::TOP : nodes[openTags].id;
+			if (!dictionary.contentModel().allows(parent, token.id))
+				errors.push_back({MISPLACED_TAG, 0, tokenizer.columnOf(token), std::string(token.name),
+					parent == ContentModel::TOP ? std::string() : nameOf(parent)});
+			if (kind == CONTAINER_TAG)
+			{
+				openTags = push(openTags, tagId(token));
+				STATS_COUNT(PUSHES);
+				STATS_DEPTH(nodes[openTags].depth);
+				if (pushed != nullptr)
+				{
+					if ((int)pushed->size() <= nodes[openTags].depth)
+						pushed->resize(nodes[openTags].depth + 1);
+					(*pushed)[nodes[openTags].depth] = tokenizer.columnOf(token);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * readFrom
+ *
+ * Reads the lines from the given one on. Past the last edited line, it
+ * stops as soon as a line starts the same way it did before the edit;
+ * the states kept for the lines after that one are still right.
+ *
+ * Parameters: first   - First line to read (its state must be right)
+ *             changed - Last line that was edited
+ */
+inline void IncrementalValidator::readFrom(int first, int changed)
+{
+	Tokenizer tokenizer(dictionary);
+	LineState current = states[first - 1];
+	if (first == 2) // Line 1 has no tags, so line 2 always starts out fresh
+		current = {tokenizer.checkpoint(), 0, 0};
+	readCount = 0;
+	for (int number = first; number <= lineCount(); number++)
+	{
+		LineState& state = states[number - 1];
+		if (number > changed && current.tokenizer == state.tokenizer
+		    && current.openTags == state.openTags)
+			return; // Same start, so the same as before from here on
+		state.tokenizer = current.tokenizer;
+		state.openTags = current.openTags;
+
+		tokenizer.resume(current.tokenizer, number);
+		std::vector<ValidationError>& errors = lineErrors[number - 1];
+		bool hadErrors = !errors.empty();
+		readLine(number, tokenizer, current.openTags, state.lowest, errors);
+		if (hadErrors != !errors.empty())
+		{
+			auto where = std::lower_bound(errorLines.begin(), errorLines.end(), number);
+			if (hadErrors)
+				errorLines.erase(where);
+			else
+				errorLines.insert(where, number);
+		}
+		current.tokenizer = tokenizer.checkpoint();
+		readCount++;
+	}
+	states.back().tokenizer = current.tokenizer; // End of the document
+	states.back().openTags = current.openTags;
+}
+
+/*
+ * replaceRange
+ *
+ * Replaces some items of a vector with others. Items that only take the
+ * place of old ones are moved in, so editing a line without adding or
+ * removing any doesn't move the rest of the document.
+ *
+ * Parameters: items   - Vector to change
+ *             at      - Index of the first item to replace
+ *             removed - Amount of items to replace
+ *             added   - New items (moved from)
+ */
+template <class Item>
+void IncrementalValidator::replaceRange(std::vector<Item>& items, int at, int removed, std::vector<Item>& added)
+{
+	int common = std::min(removed, (int)added.size());
+	std::move(added.begin(), added.begin() + common, items.begin() + at);
+	if (removed > common)
+		items.erase(items.begin() + at + common, items.begin() + at + removed);
+	else
+		items.insert(items.begin() + at + common, std::make_move_iterator(added.begin() + common),
+			std::make_move_iterator(added.end()));
+}
+
+/*
+ * load
+ *
+ * Parameters: document - Whole text of the document
+ */
+inline void IncrementalValidator::load(std::string_view document)
+{
+	lines.clear();
+	std::size_t start = 0, lineEnd;
+	while ((lineEnd = document.find('\n', start)) != std::string_view::npos)
+	{
+		lines.emplace_back(document.substr(start, lineEnd + 1 - start));
+		start = lineEnd + 1;
+	}
+	lines.emplace_back(document.substr(start)); // The last line, maybe empty
+
+	nodes.assign(1, {TagDictionary::UNKNOWN_ID, 0, 0});
+	nodeOf.clear();
+	customIds.clear();
+	customNames.clear();
+	states.assign(lines.size() + 1, LineState());
+	lineErrors.assign(lines.size(), std::vector<ValidationError>());
+	errorLines.clear();
+	readFrom(2, lineCount());
+	readCount = lineCount();
+}
+
+/*
+ * replaceLines
+ *
+ * Replaces lines first to last (counting from 1, both included) with
+ * some text, which may have any amount of lines. With last = first - 1,
+ * the text is inserted before line first. Text that doesn't end in '\n'
+ * is joined with the line that follows it.
+ *
+ * Parameters: first       - First line to replace
+ *             last        - Last line to replace
+ *             replacement - New text of those lines
+ */
+inline void IncrementalValidator::replaceLines(int first, int last, std::string_view replacement)
+{
+	first = std::min(std::max(first, 1), lineCount() + 1);
+	last = std::min(std::max(last, first - 1), lineCount());
+	std::string text(replacement);
+	if (first > 1 && (lines[first - 2].empty() || lines[first - 2].back() != '\n')) // Only the last line has no '\n'
+	{
+		first--;
+		text.insert(0, lines[first - 1]);
+	}
+	if (last < lineCount() && (text.empty() || text.back() != '\n'))
+		text += lines[last++];
+
+	// Split the new text into lines
+	std::vector<std::string> added;
+	std::size_t start = 0, lineEnd;
+	while ((lineEnd = text.find('\n', start)) != std::string::npos)
+	{
+		added.push_back(text.substr(start, lineEnd + 1 - start));
+		start = lineEnd + 1;
+	}
+	if (start < text.size() || last == lineCount()) // The document ends with its own last line
+		added.push_back(text.substr(start));
+
+	/* Put them in place of the old ones. The line after them keeps its
+	 * old state, to tell when reading can stop. */
+	LineState fresh = states[first - 1]; // Start of the first line doesn't change
+	fresh.lowest = 0;
+	int removed = last - first + 1;
+	auto from = std::lower_bound(errorLines.begin(), errorLines.end(), first);
+	auto to = std::upper_bound(errorLines.begin(), errorLines.end(), last);
+	for (auto it = to; it != errorLines.end(); ++it) // The lines after move
+		*it += (int)added.size() - removed;
+	errorLines.erase(from, to);
+	std::vector<std::vector<ValidationError>> noErrors(added.size());
+	std::vector<LineState> freshStates(added.size(), fresh);
+	replaceRange(lines, first - 1, removed, added);
+	replaceRange(lineErrors, first - 1, removed, noErrors);
+	replaceRange(states, first - 1, removed, freshStates);
+
+	/* Nodes (and custom element names) made by earlier edits pile up,
+	 * so now and then start over with only the ones in use */
+	if (nodes.size() + customNames.size() > 8 * lines.size() + 4096)
+	{
+		load(this->text());
+		return;
+	}
+	int changed = first + (int)added.size() - 1;
+	if (first == 1 && last == 0) // Old line 1 moved down, and its tags were never read
+		changed++;
+	readFrom(std::max(first, 2), changed);
+}
+
+/*
+ * checkFirstLine
+ *
+ * Returns: True if line 1 is <!DOCTYPE html>, false otherwise
+ */
+inline bool IncrementalValidator::checkFirstLine() const
+{
+	std::string_view first = lines[0];
+	if (!first.empty() && first.back() == '\n')
+		first.remove_suffix(1);
+	return first == DOCTYPE;
+}
+
+/*
+ * unclosedTags
+ *
+ * Finds where each tag left open at the end was opened, outermost first.
+ * The tag at depth d was last opened in the last line where there were
+ * fewer than d open tags at some point, so the lines are searched from
+ * the end, and only those lines are read again for the columns.
+ *
+ * Parameters: errors - Where the errors are added
+ */
+inline void IncrementalValidator::unclosedTags(std::vector<ValidationError>& errors)
+{
+	int open = states.back().openTags;
+	int missing = nodes[open].depth; // deepest tag whose line isn't known yet
+	std::vector<int> lineOf(missing + 1), columnOf(missing + 1);
+	std::vector<ValidationError> ignored;
+	std::vector<int> pushed;
+	Tokenizer tokenizer(dictionary);
+	for (int number = lineCount(); number >= 2 && missing > 0; number--)
+	{
+		const LineState& state = states[number - 1];
+		if (state.lowest >= missing)
+			continue;
+		int openTags = state.openTags, lowest;
+		pushed.clear();
+		tokenizer.resume(state.tokenizer, number);
+		readLine(number, tokenizer, openTags, lowest, ignored, &pushed);
+		for (; missing > state.lowest; missing--)
+		{
+			lineOf[missing] = number;
+			columnOf[missing] = pushed[missing];
+		}
+	}
+
+	std::vector<int> ids(nodes[open].depth + 1);
+	for (int node = open; node != 0; node = nodes[node].below)
+		ids[nodes[node].depth] = nodes[node].id;
+	for (int depth = 1; depth < (int)ids.size(); depth++)
+		errors.push_back({UNCLOSED_TAG, lineOf[depth], columnOf[depth], nameOf(ids[depth]), ""});
+}
+
+/*
+ * result
+ *
+ * Returns: Result of validating the current document, the same as
+ *          Validator gives with the same amount of errors
+ */
+inline ValidationResult IncrementalValidator::result()
+{
+	ValidationResult result;
+	result.status = VALID;
+	result.line = 1;
+	result.column = 0;
+	result.truncated = false;
+
+	if (!checkFirstLine())
+		result.errors.push_back({MISSING_DOCTYPE, 1, 0, "", ""});
+	for (size_t i = 0; i < errorLines.size() && (int)result.errors.size() < maxErrors; i++)
+		for (const ValidationError& error : lineErrors[errorLines[i] - 1])
+		{
+			result.errors.push_back(error);
+			result.errors.back().line = errorLines[i];
+		}
+
+	int lastLine = lineCount(); // Counted like getline: a '\n' at the end doesn't start a line
+	if (lineCount() > 1 && lines.back().empty())
+		lastLine--;
+	if ((int)result.errors.size() < maxErrors && states.back().openTags != 0)
+	{
+		if (maxErrors == 1) // Only the innermost one, at the end
+			result.errors.push_back({UNCLOSED_TAG, lastLine, 0, nameOf(nodes[states.back().openTags].id), ""});
+		else
+			unclosedTags(result.errors);
+	}
+
+	if ((int)result.errors.size() >= maxErrors)
+	{
+		result.errors.resize(maxErrors);
+		result.truncated = maxErrors > 1;
+	}
+	if (!result.errors.empty())
+		(ValidationError&)result = result.errors[0];
+	else if (maxErrors == 1)
+		result.line = lastLine;
+	return result;
+}
+
+/*
+ * text
+ *
+ * Returns: Whole text of the current document
+ */
+inline std::string IncrementalValidator::text() const
+{
+	std::string document;
+	for (const std::string& line : lines)
+		document += line;
+	return document;
+}
+
+/*
+ * lineCount
+ *
+ * Returns: Amount of lines, counting the (maybe empty) text after the
+ *          last '\n' as a line
+ */
+inline int IncrementalValidator::lineCount() const
+{
+	return (int)lines.size();
+}
+
+/*
+ * linesRead
+ *
+ * Returns: Amount of lines the last load or edit had to read
+ */
+inline int IncrementalValidator::linesRead() const
+{
+	return readCount;
+}
+
+#endif
@@ -8,6 +8,8 @@
 #ifndef LINKEDSTACK_H
 #define LINKEDSTACK_H
 
+#include <iostream>
+#include <utility>
 #include "StackADT.h"
 
 template <class Type>
@@ -30,8 +32,9 @@ class LinkedStack : public StackADT<Type>
 		~LinkedStack(); // destructor
 
 		void push(const Type&); // add to top of stack
+		void push(Type&&); // add to top of stack, moving the element
 		Type pop(); // remove and return top of stack
-		Type top() const; // return top of stack
+		const Type& top() const; // return top of stack
 	private:
 		void copyStack(const LinkedStack<Type>&); // Used by copy constructor and operator=
 
@@ -133,12 +136,22 @@ void LinkedStack<Type>::push(const Type& obj)
 	this->currentSize++;
 }
 
+template <class Type>
+void LinkedStack<Type>::push(Type&& obj)
+{
+	nodeType<Type> *newNode = new nodeType<Type>;
+	newNode->data = std::move(obj);
+	newNode->next = stackTop;
+	stackTop = newNode;
+	this->currentSize++;
+}
+
 template <class Type>
 Type LinkedStack<Type>::pop()
 {
 	if (this->isEmpty())
 		throw "EXCEPTION: Stack is empty!";
-	Type etr = stackTop->data;
+	Type etr = std::move(stackTop->data);
 	nodeType<Type> *nodeToDelete = stackTop;
 	stackTop = stackTop->next;
 	delete nodeToDelete;
@@ -148,7 +161,7 @@ Type LinkedStack<Type>::pop()
 }
 
 template <class Type>
-Type LinkedStack<Type>::top() const
+const Type& LinkedStack<Type>::top() const
 {
 	if (this->isEmpty())
 		throw "EXCEPTION: Stack is empty!";
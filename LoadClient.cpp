@@ -0,0 +1,232 @@
+/********************************************************
+*   Project: HTML Validator using a stack and two sets
+*   Author: Gustavo A. Rassi
+*********************************************************
+* Description: Sends documents made up by HtmlGenerator
+*              to a validator started with --serve, from
+*              many clients at once, and reports how long
+*              the responses took (p50, p99 and worst).
+*
+*   Usage: LoadClient [--socket PATH] [--clients N]
+*                     [--requests N] [--size BYTES]
+*                     [--errors RATE] [--seed N]
+********************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "HtmlGenerator.h"
+#include "TagDictionary.h"
+using namespace std;
+
+struct ClientResults
+{
+    vector<double> latencies; // microseconds per request
+    long long invalid = 0; // documents the server found errors in
+    bool failed = false; // lost the connection
+};
+
+/*
+ * connectTo
+ *
+ * Parameters: path - Path of the server's socket
+ * Returns: Connected socket, or -1 if the server isn't there
+ */
+int connectTo(const string& path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof address);
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof address.sun_path)
+        return -1;
+    strcpy(address.sun_path, path.c_str());
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(client >= 0 && connect(client, (sockaddr *)&address, sizeof address) != 0)
+    {
+        close(client);
+        return -1;
+    }
+    return client;
+}
+
+/*
+ * sendAll / receiveAll
+ *
+ * Parameters: client - Connected socket
+ *             data   - Bytes to send, or where the bytes received go
+ *             length - Amount of bytes
+ * Returns: True if every byte went through, false if the connection broke
+ */
+bool sendAll(int client, const char* data, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t sent = send(client, data, length, MSG_NOSIGNAL);
+        if(sent <= 0)
+            return false;
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+bool receiveAll(int client, char* data, size_t length)
+{
+    while(length > 0)
+    {
+        ssize_t received = recv(client, data, length, 0);
+        if(received <= 0)
+            return false;
+        data += received;
+        length -= received;
+    }
+    return true;
+}
+
+/*
+ * runClient
+ *
+ * Sends the documents one at a time on a single connection, waiting
+ * for each response before sending the next.
+ *
+ * Parameters: path      - Path of the server's socket
+ *             documents - Requests ready to send (length and document)
+ *             requests  - Amount of requests to send
+ *             first     - Index of the first document to send
+ *             results   - Where the latencies go
+ */
+void runClient(const string& path, const vector<string>& documents, int requests, int first, ClientResults& results)
+{
+    int client = connectTo(path);
+    if(client < 0)
+    {
+        results.failed = true;
+        return;
+    }
+    results.latencies.reserve(requests);
+    string response;
+    for(int i = 0; i < requests; i++)
+    {
+        const string& request = documents[(first + i) % documents.size()];
+        auto start = chrono::steady_clock::now();
+        unsigned char header[4];
+        if(!sendAll(client, request.data(), request.size()) || !receiveAll(client, (char *)header, 4))
+        {
+            results.failed = true;
+            break;
+        }
+        uint32_t length = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+        response.resize(length);
+        if(!receiveAll(client, &response[0], length))
+        {
+            results.failed = true;
+            break;
+        }
+        results.latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        static const string VALID_START = "{\"status\": \"valid\"";
+        if(response.compare(0, VALID_START.size(), VALID_START) != 0)
+            results.invalid++;
+    }
+    close(client);
+}
+
+/*
+ * percentile
+ *
+ * Parameters: sorted - Values in increasing order (at least one)
+ *             p      - From 0 to 1
+ * Returns: Smallest value with at least p of the values at or below it
+ */
+double percentile(const vector<double>& sorted, double p)
+{
+    size_t index = (size_t)ceil(p * sorted.size());
+    return sorted[index > 0 ? index - 1 : 0];
+}
+
+int main(int argc, char* argv[])
+{
+    string path = "htmlvalidator.sock";
+    int clients = 8, requests = 1000;
+    GeneratorOptions options;
+    options.bytes = 2048; // Small fragments, where starting a process costs the most
+    options.maxDepth = 6;
+    for(int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if(strcmp(argv[i], "--socket") == 0 && hasValue)
+            path = argv[++i];
+        else if(strcmp(argv[i], "--clients") == 0 && hasValue)
+            clients = max(atoi(argv[++i]), 1);
+        else if(strcmp(argv[i], "--requests") == 0 && hasValue)
+            requests = max(atoi(argv[++i]), 1);
+        else if(strcmp(argv[i], "--size") == 0 && hasValue)
+            options.bytes = (size_t)max(atol(argv[++i]), 1L);
+        else if(strcmp(argv[i], "--errors") == 0 && hasValue)
+            options.errorRate = atof(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && hasValue)
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        else
+        {
+            cerr << "Unknown option: " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    // Make the documents first, so only the server is measured
+    TagDictionary dictionary;
+    dictionary.addBuiltin();
+    vector<string> documents;
+    for(int i = 0; i < 64; i++)
+    {
+        GeneratorOptions document = options;
+        document.seed = options.seed + i;
+        string html = HtmlGenerator(dictionary, document).generate();
+        string request(4, '\0');
+        for(int b = 0; b < 4; b++)
+            request[b] = (char)((html.size() >> (8 * b)) & 0xFF);
+        documents.push_back(request + html);
+    }
+
+    vector<ClientResults> results(clients);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for(int c = 0; c < clients; c++)
+        threads.emplace_back(runClient, path, cref(documents), requests, c * 7, ref(results[c]));
+    for(thread& t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> latencies;
+    long long invalid = 0;
+    int failed = 0;
+    for(const ClientResults& client : results)
+    {
+        latencies.insert(latencies.end(), client.latencies.begin(), client.latencies.end());
+        invalid += client.invalid;
+        failed += client.failed;
+    }
+    if(latencies.empty())
+    {
+        cerr << "No responses from " << path << " (is the validator running with --serve?)\n";
+        return 1;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << "requests: " << latencies.size() << " (" << invalid << " invalid documents)\n";
+    cout << "clients: " << clients << (failed > 0 ? " (" + to_string(failed) + " lost their connection)" : "") << "\n";
+    cout << "throughput: " << (long long)(latencies.size() / seconds) << " requests/s\n";
+    cout << "latency p50: " << percentile(latencies, 0.50) << " us\n";
+    cout << "latency p99: " << percentile(latencies, 0.99) << " us\n";
+    cout << "latency max: " << latencies.back() << " us\n";
+    return failed > 0 ? 1 : 0;
+}
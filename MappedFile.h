@@ -0,0 +1,169 @@
+/*****************************************************
+ * MappedFile.h
+ *
+ * Read-only view of a whole file. On POSIX systems
+ * the file is memory-mapped, so its bytes are never
+ * copied; elsewhere (or if mmap fails) the file is
+ * read into a single buffer.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile
+{
+	public:
+		MappedFile(); // constructor
+		MappedFile(const MappedFile&) = delete; // a mapping can't be shared
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile(); // destructor
+
+		bool open(const char*); // map a file, replacing any previous one
+		void close();
+		bool isOpen() const;
+		const char* data() const; // first byte of the file
+		std::size_t size() const; // amount of bytes in the file
+	private:
+		bool readWhole(const char*); // fallback when the file can't be mapped
+
+		const char *bytes;
+		std::size_t length;
+		bool opened;
+		bool mapped; // true if bytes must be unmapped, false if it points into buffer
+		std::vector<char> buffer;
+};
+
+/* Constructor */
+inline MappedFile::MappedFile()
+{
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+	mapped = false;
+}
+
+/* Destructor */
+inline MappedFile::~MappedFile()
+{
+	close();
+}
+
+/*
+ * open
+ *
+ * Makes the contents of a file available through data() and size().
+ *
+ * Parameters: path - Path of the file
+ * Returns: True if the file could be opened, false otherwise
+ */
+inline bool MappedFile::open(const char* path)
+{
+	close();
+#if !defined(_WIN32)
+	int fd = ::open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+	{
+		void *view = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view != MAP_FAILED)
+		{
+			madvise(view, (std::size_t)info.st_size, MADV_SEQUENTIAL); // only a hint
+			::close(fd);
+			bytes = (const char *)view;
+			length = (std::size_t)info.st_size;
+			mapped = true;
+			opened = true;
+			return true;
+		}
+	}
+	::close(fd);
+#endif
+	/* Empty files, pipes and systems without mmap */
+	return readWhole(path);
+}
+
+/*
+ * readWhole
+ *
+ * Reads the whole file into the buffer.
+ *
+ * Parameters: path - Path of the file
+ * Returns: True if the file could be opened, false otherwise
+ */
+inline bool MappedFile::readWhole(const char* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open())
+		return false;
+	char chunk[65536];
+	while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+		buffer.insert(buffer.end(), chunk, chunk + in.gcount());
+	bytes = buffer.data();
+	length = buffer.size();
+	opened = true;
+	return true;
+}
+
+/*
+ * close
+ *
+ * Releases the file. data() must not be used afterwards.
+ */
+inline void MappedFile::close()
+{
+#if !defined(_WIN32)
+	if (mapped)
+		munmap((void *)bytes, length);
+#endif
+	buffer.clear();
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+	mapped = false;
+}
+
+/*
+ * isOpen
+ *
+ * Returns: True if a file is currently open, false otherwise
+ */
+inline bool MappedFile::isOpen() const
+{
+	return opened;
+}
+
+/*
+ * data
+ *
+ * Returns: Pointer to the first byte of the file (nullptr if empty)
+ */
+inline const char* MappedFile::data() const
+{
+	return bytes;
+}
+
+/*
+ * size
+ *
+ * Returns: Amount of bytes in the file
+ */
+inline std::size_t MappedFile::size() const
+{
+	return length;
+}
+
+#endif
@@ -0,0 +1,458 @@
+/*****************************************************
+ * ReportWriter.h
+ *
+ * Prints the results of a run as text (the usual
+ * messages), JSON Lines (one object per error) or
+ * SARIF (the format CI systems read to annotate
+ * code), so other programs don't have to parse the
+ * text.
+ *
+ * Everything goes through a large buffer that's only
+ * written out when it fills up or at the end; std::endl
+ * doesn't flush it either, so thousands of files cost
+ * a few writes instead of one per message.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef REPORTWRITER_H
+#define REPORTWRITER_H
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Validator.h"
+
+/*
+ * appendJsonString
+ *
+ * Quotes a string for JSON, escaping quotes, backslashes and control
+ * characters. Runs of plain characters are copied at once. Every JSON
+ * string written (reports and server responses) goes through here.
+ *
+ * Parameters: out  - Where it goes: anything with append(std::string_view),
+ *                    e.g. an OutputBuffer or a std::string
+ *             text - String to add (UTF-8 is kept as it is)
+ */
+template <class Output>
+inline void appendJsonString(Output& out, std::string_view text)
+{
+	out.append(std::string_view("\""));
+	std::size_t plain = 0;
+	for (std::size_t i = 0; i < text.size(); i++)
+	{
+		unsigned char c = (unsigned char)text[i];
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+		out.append(text.substr(plain, i - plain));
+		if (c == '"' || c == '\\')
+		{
+			char escaped[2] = {'\\', (char)c};
+			out.append(std::string_view(escaped, 2));
+		}
+		else
+		{
+			static const char HEX[] = "0123456789abcdef";
+			char escaped[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15]};
+			out.append(std::string_view(escaped, 6));
+		}
+		plain = i + 1;
+	}
+	out.append(text.substr(plain));
+	out.append(std::string_view("\""));
+}
+
+/*
+ * uriReference
+ *
+ * Percent-encodes a path for a URI, as SARIF requires: only letters,
+ * digits, '-', '.', '_', '~' and '/' are kept, so a space, '#', '%',
+ * '?' or a non-ASCII byte can't change what the URI points at.
+ *
+ * Parameters: path - Path of a file, relative or absolute
+ * Returns: The path as a relative URI reference (e.g. "a%20b%231.html")
+ */
+inline std::string uriReference(std::string_view path)
+{
+	static const char HEX[] = "0123456789ABCDEF";
+	std::string uri;
+	uri.reserve(path.size());
+	for (char c : path)
+	{
+		unsigned char byte = (unsigned char)c;
+		if ((byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || (byte >= '0' && byte <= '9')
+		    || byte == '-' || byte == '.' || byte == '_' || byte == '~' || byte == '/')
+			uri += c;
+		else
+		{
+			uri += '%';
+			uri += HEX[byte >> 4];
+			uri += HEX[byte & 15];
+		}
+	}
+	return uri;
+}
+
+/* Output buffer usable by any std::ostream, flushed only when full */
+class OutputBuffer : public std::streambuf
+{
+	public:
+		OutputBuffer(std::FILE* = stdout, std::size_t = 1 << 16); // constructor, for a file and a size
+		OutputBuffer(const OutputBuffer&) = delete;
+		OutputBuffer& operator=(const OutputBuffer&) = delete;
+		~OutputBuffer(); // destructor, writes what's left
+
+		void append(std::string_view); // add bytes
+		void appendNumber(long long); // add a number in decimal
+		void appendJson(std::string_view); // add a JSON string, quoted and escaped
+		void flush(); // write everything out now
+	protected:
+		int_type overflow(int_type) override;
+		std::streamsize xsputn(const char*, std::streamsize) override;
+		int sync() override; // std::flush and std::endl: keep buffering
+	private:
+		std::FILE *file;
+		std::vector<char> buffer;
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: output   - Where the bytes go
+ *             capacity - Bytes kept before writing
+ */
+inline OutputBuffer::OutputBuffer(std::FILE* output, std::size_t capacity)
+	: file(output), buffer(capacity < 64 ? 64 : capacity)
+{
+	setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+/* Destructor */
+inline OutputBuffer::~OutputBuffer()
+{
+	flush();
+}
+
+/*
+ * flush
+ *
+ * Writes the buffer out, together with anything stdio holds for the
+ * same file (e.g. from std::cout).
+ */
+inline void OutputBuffer::flush()
+{
+	if (pptr() != pbase())
+		std::fwrite(pbase(), 1, pptr() - pbase(), file);
+	setp(buffer.data(), buffer.data() + buffer.size());
+	std::fflush(file);
+}
+
+inline void OutputBuffer::append(std::string_view text)
+{
+	if ((std::size_t)(epptr() - pptr()) >= text.size()) // Nearly always
+	{
+		std::memcpy(pptr(), text.data(), text.size());
+		pbump((int)text.size());
+	}
+	else
+		xsputn(text.data(), (std::streamsize)text.size());
+}
+
+inline void OutputBuffer::appendNumber(long long number)
+{
+	char digits[24];
+	char *end = std::to_chars(digits, digits + sizeof digits, number).ptr;
+	append(std::string_view(digits, end - digits));
+}
+
+/*
+ * appendJson
+ *
+ * Parameters: text - String to add, quoted and escaped (see appendJsonString)
+ */
+inline void OutputBuffer::appendJson(std::string_view text)
+{
+	appendJsonString(*this, text);
+}
+
+inline OutputBuffer::int_type OutputBuffer::overflow(int_type c)
+{
+	flush();
+	if (c != traits_type::eof())
+	{
+		*pptr() = (char)c;
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+inline std::streamsize OutputBuffer::xsputn(const char* data, std::streamsize length)
+{
+	if (length > epptr() - pptr())
+	{
+		flush();
+		if (length >= epptr() - pptr()) // Bigger than the buffer: no point copying it
+		{
+			std::fwrite(data, 1, length, file);
+			return length;
+		}
+	}
+	std::memcpy(pptr(), data, length);
+	pbump((int)length);
+	return length;
+}
+
+inline int OutputBuffer::sync()
+{
+	return 0;
+}
+
+enum ReportFormat
+{
+	TEXT_REPORT, // the messages people read
+	JSONL_REPORT, // one JSON object per line and error
+	SARIF_REPORT // a single SARIF 2.1.0 log
+};
+
+class ReportWriter
+{
+	public:
+		ReportWriter(ReportFormat, int, std::FILE* = stdout); // constructor
+		~ReportWriter(); // destructor, ends the report
+
+		void add(const std::string&, const ValidationResult&, bool = true); // results of a file
+		void finish(); // end the report and write it out
+
+		static bool parseFormat(const char*, ReportFormat&); // "text", "jsonl" or "sarif"
+	private:
+		void addJsonLines(const std::string&, const ValidationResult&);
+		void addSarif(const std::string&, const ValidationResult&);
+
+		ReportFormat format;
+		int maxErrors;
+		OutputBuffer buffer;
+		std::ostream text; // for the text messages, over the same buffer
+		bool firstResult; // no SARIF result written yet
+		bool finished;
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: reportFormat - Format of the report
+ *             errorLimit   - Errors collected per file (for text, more
+ *                            than 1 prints every error with its column)
+ *             output       - Where the report goes
+ */
+inline ReportWriter::ReportWriter(ReportFormat reportFormat, int errorLimit, std::FILE* output)
+	: format(reportFormat), maxErrors(errorLimit), buffer(output), text(&buffer)
+{
+	firstResult = true;
+	finished = false;
+	if (format != SARIF_REPORT)
+		return;
+	buffer.append("{\"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\", \"version\": \"2.1.0\", "
+		"\"runs\": [{\"tool\": {\"driver\": {\"name\": \"HTMLValidator\", \"rules\": [");
+	for (int status = FILE_NOT_FOUND; status <= MISPLACED_TAG; status++)
+	{
+		buffer.append(status > FILE_NOT_FOUND ? ", {\"id\": " : "{\"id\": ");
+		buffer.appendJson(statusName((ValidationStatus)status));
+		buffer.append("}");
+	}
+	buffer.append("]}}, \"results\": [");
+}
+
+/* Destructor */
+inline ReportWriter::~ReportWriter()
+{
+	finish();
+}
+
+/*
+ * parseFormat
+ *
+ * Parameters: name   - Name given on the command line
+ *             result - Where the format goes
+ * Returns: True if the name is a format, false otherwise
+ */
+inline bool ReportWriter::parseFormat(const char* name, ReportFormat& result)
+{
+	if (std::strcmp(name, "text") == 0)
+		result = TEXT_REPORT;
+	else if (std::strcmp(name, "jsonl") == 0)
+		result = JSONL_REPORT;
+	else if (std::strcmp(name, "sarif") == 0)
+		result = SARIF_REPORT;
+	else
+		return false;
+	return true;
+}
+
+/*
+ * add
+ *
+ * Parameters: file     - File the result is for
+ *             result   - Result of validating it
+ *             withName - For text: put the file name before each message
+ *                        (false prints a single result the classic way)
+ */
+inline void ReportWriter::add(const std::string& file, const ValidationResult& result, bool withName)
+{
+	if (format == JSONL_REPORT)
+		addJsonLines(file, result);
+	else if (format == SARIF_REPORT)
+		addSarif(file, result);
+	else if (maxErrors > 1)
+		printErrors(text, result, withName ? file + ": " : "");
+	else if (withName)
+		text << file << ": " << resultMessage(result) << "\n";
+	else
+		printResult(text, result);
+}
+
+/*
+ * addJsonLines
+ *
+ * One line per error, or a single "valid" line for a valid file:
+ * {"file": ..., "kind": ..., "line": ..., "column": ..., "tag": ...,
+ *  "expected": ..., "message": ...}. "expected" is only there for a
+ * closing tag that doesn't match. A file that had more errors than were
+ * collected ends with a line of kind "truncated".
+ */
+inline void ReportWriter::addJsonLines(const std::string& file, const ValidationResult& result)
+{
+	if (result.errors.empty())
+	{
+		buffer.append("{\"file\": ");
+		buffer.appendJson(file);
+		buffer.append(", \"kind\": \"valid\"}\n");
+		return;
+	}
+	for (const ValidationError& error : result.errors)
+	{
+		buffer.append("{\"file\": ");
+		buffer.appendJson(file);
+		buffer.append(", \"kind\": \"");
+		buffer.append(statusName(error.status));
+		buffer.append("\", \"line\": ");
+		buffer.appendNumber(error.line);
+		buffer.append(", \"column\": ");
+		buffer.appendNumber(error.column);
+		buffer.append(", \"tag\": ");
+		buffer.appendJson(error.tag);
+		if (!error.expected.empty())
+		{
+			buffer.append(", \"expected\": ");
+			buffer.appendJson(error.expected);
+		}
+		buffer.append(", \"message\": ");
+		buffer.appendJson(errorMessage(error));
+		buffer.append("}\n");
+	}
+	if (result.truncated)
+	{
+		buffer.append("{\"file\": ");
+		buffer.appendJson(file);
+		buffer.append(", \"kind\": \"truncated\", \"errors\": ");
+		buffer.appendNumber((long long)result.errors.size());
+		buffer.append("}\n");
+	}
+}
+
+/*
+ * addSarif
+ *
+ * One SARIF result per error, located at its line and column (when
+ * known). Valid files add nothing.
+ */
+inline void ReportWriter::addSarif(const std::string& file, const ValidationResult& result)
+{
+	std::string uri = uriReference(file);
+	for (const ValidationError& error : result.errors)
+	{
+		buffer.append(firstResult ? "\n" : ",\n");
+		firstResult = false;
+		buffer.append("{\"ruleId\": \"");
+		buffer.append(statusName(error.status));
+		buffer.append("\", \"level\": \"error\", \"message\": {\"text\": ");
+		buffer.appendJson(errorMessage(error));
+		buffer.append("}, \"locations\": [{\"physicalLocation\": {\"artifactLocation\": {\"uri\": ");
+		buffer.appendJson(uri);
+		buffer.append("}");
+		if (error.line > 0)
+		{
+			buffer.append(", \"region\": {\"startLine\": ");
+			buffer.appendNumber(error.line);
+			if (error.column > 0)
+			{
+				buffer.append(", \"startColumn\": ");
+				buffer.appendNumber(error.column);
+			}
+			buffer.append("}");
+		}
+		buffer.append("}}]");
+		if (!error.expected.empty())
+		{
+			buffer.append(", \"properties\": {\"tag\": ");
+			buffer.appendJson(error.tag);
+			buffer.append(", \"expected\": ");
+			buffer.appendJson(error.expected);
+			buffer.append("}");
+		}
+		buffer.append("}");
+	}
+}
+
+/*
+ * finish
+ *
+ * Ends the report (for SARIF, closes the log) and writes it out. Nothing
+ * can be added afterwards.
+ */
+inline void ReportWriter::finish()
+{
+	if (finished)
+		return;
+	finished = true;
+	if (format == SARIF_REPORT)
+		buffer.append("\n]}]}\n");
+	buffer.flush();
+}
+
+/*
+ * resultJson
+ *
+ * Parameters: result - Result of a validation
+ * Returns: The result as a JSON object, in a single line
+ */
+inline std::string resultJson(const ValidationResult& result)
+{
+	std::string json = "{\"status\": \"";
+	json += statusName(result.status);
+	json += "\", \"errors\": [";
+	for (size_t i = 0; i < result.errors.size(); i++)
+	{
+		const ValidationError& error = result.errors[i];
+		json += (i > 0 ? ", {\"status\": \"" : "{\"status\": \"");
+		json += statusName(error.status);
+		json += "\", \"line\": " + std::to_string(error.line) + ", \"column\": " + std::to_string(error.column);
+		json += ", \"tag\": ";
+		appendJsonString(json, error.tag);
+		if (!error.expected.empty())
+		{
+			json += ", \"expected\": ";
+			appendJsonString(json, error.expected);
+		}
+		json += ", \"message\": ";
+		appendJsonString(json, errorMessage(error));
+		json += "}";
+	}
+	json += result.truncated ? "], \"truncated\": true}" : "], \"truncated\": false}";
+	return json;
+}
+
+#endif
@@ -14,8 +14,9 @@ class StackADT
 {
 	public:
 		virtual void push(const Type&) = 0; // add element to the top of the stack
+		virtual void push(Type&&) = 0; // add element to the top of the stack, moving it
 		virtual Type pop() = 0; // remove and return element from top of the stack
-		virtual Type top() const = 0; // retrieve element from the top of the stack
+		virtual const Type& top() const = 0; // retrieve element from the top of the stack
 
 		/* Non-virtual functions */
 		int size() const;
@@ -9,7 +9,11 @@
 #ifndef STATICSET_H
 #define STATICSET_H
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
 
 template <class Type>
 class StaticSet
@@ -18,11 +22,20 @@ class StaticSet
 	friend std::ostream& operator<<(std::ostream&, const StaticSet<T>&);
 
 	public:
+		typedef const Type* const_iterator; // elements are stored contiguously
+
 		StaticSet(int = DEFAULTAMT); // constructor with default parameter
+		template <class Iterator>
+		StaticSet(Iterator, Iterator); // constructor from a range of elements
 		StaticSet(const StaticSet<Type> &); // Copy constructor
+		StaticSet(StaticSet<Type> &&); // Move constructor
 		const StaticSet<Type>& operator=(const StaticSet<Type> &); // Overload =
+		const StaticSet<Type>& operator=(StaticSet<Type> &&); // Overload = (move)
 		~StaticSet(); // destructor
 		
+		void reserve(int); // make room for more elements
+		void shrinkToFit(); // release the room that isn't used
+		int maxSize() const; // amount of elements that fit
 		void add(const Type &);
 		bool remove(const Type &); // remove a single copy
 		int removeAll(const Type &); // remove ALL copies
@@ -31,11 +44,16 @@ class StaticSet
 		int size() const; // amount of elements
 		bool isEmpty() const;
 		Type* asArray() const;
+		const_iterator begin() const; // first element (no particular order)
+		const_iterator end() const; // one past the last element
 		StaticSet<Type> setunion(const StaticSet<Type> &) const;
 		StaticSet<Type> intersection(const StaticSet<Type> &) const;
 		StaticSet<Type> difference(const StaticSet<Type> &) const;
 		bool isSubset(const StaticSet<Type> &) const;
 	private:
+		std::vector<const Type*> sortedElements() const; // for binary search
+		static bool contains(const std::vector<const Type*> &, const Type &);
+
 		int currentSize, capacity;
 		Type *elements;
 		static const int DEFAULTAMT = 10;
@@ -54,6 +72,31 @@ StaticSet<Type>::StaticSet(int initialCapacity)
 	currentSize = 0; // Set is initially empty
 }
 
+/*
+ * Constructor
+ *
+ * Builds the set from a range of elements, e.g. a vector or another set.
+ * Repeated elements are kept once. The elements are sorted first, so
+ * this takes O(n log n) instead of the O(n^2) of adding them one by one.
+ * Type must have operator<.
+ *
+ * Parameters: first - First element
+ *             last  - One past the last element
+ */
+template <class Type>
+template <class Iterator>
+StaticSet<Type>::StaticSet(Iterator first, Iterator last)
+{
+	std::vector<Type> unique(first, last);
+	std::sort(unique.begin(), unique.end());
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+	capacity = unique.empty() ? DEFAULTAMT : (int)unique.size();
+	elements = new Type[capacity];
+	currentSize = (int)unique.size();
+	for (int i = 0; i < currentSize; i++)
+		elements[i] = std::move(unique[i]);
+}
+
 /* Copy constructor */
 template <class Type>
 StaticSet<Type>::StaticSet(const StaticSet<Type>& otherSet)
@@ -88,6 +131,38 @@ const StaticSet<Type>& StaticSet<Type>::operator=(const StaticSet<Type>& otherSe
 	return *this;
 }
 
+/* Move constructor */
+template <class Type>
+StaticSet<Type>::StaticSet(StaticSet<Type>&& otherSet)
+{
+	/* Take otherSet's array instead of copying it. otherSet is left
+	 * empty, with no room (adding to it does nothing). */
+	currentSize = otherSet.currentSize;
+	capacity = otherSet.capacity;
+	elements = otherSet.elements;
+	otherSet.currentSize = 0;
+	otherSet.capacity = 0;
+	otherSet.elements = nullptr;
+}
+
+/* Overloading assignment operator (=) for temporaries */
+template <class Type>
+const StaticSet<Type>& StaticSet<Type>::operator=(StaticSet<Type>&& otherSet)
+{
+	if (this != &otherSet)
+	{
+		delete [] elements;
+		currentSize = otherSet.currentSize;
+		capacity = otherSet.capacity;
+		elements = otherSet.elements;
+		otherSet.currentSize = 0;
+		otherSet.capacity = 0;
+		otherSet.elements = nullptr;
+	}
+
+	return *this;
+}
+
 /* Destructor */
 template <class Type>
 StaticSet<Type>::~StaticSet()
@@ -95,6 +170,58 @@ StaticSet<Type>::~StaticSet()
 	delete [] elements; // Avoid memory leak
 }
 
+/*
+ * reserve
+ *
+ * Grows the array so it can hold at least newCapacity elements. The
+ * elements are moved, not copied, and aren't checked for duplicates
+ * again (they're already known to be different).
+ *
+ * Parameters: newCapacity - Amount of elements that must fit
+ */
+template <class Type>
+void StaticSet<Type>::reserve(int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+	Type *bigger = new Type[newCapacity];
+	for (int i = 0; i < currentSize; i++)
+		bigger[i] = std::move(elements[i]);
+	delete [] elements;
+	elements = bigger;
+	capacity = newCapacity;
+}
+
+/*
+ * shrinkToFit
+ *
+ * Shrinks the array to the amount of elements (at least 1).
+ */
+template <class Type>
+void StaticSet<Type>::shrinkToFit()
+{
+	int newCapacity = currentSize > 0 ? currentSize : 1;
+	if (newCapacity == capacity)
+		return;
+	Type *smaller = new Type[newCapacity];
+	for (int i = 0; i < currentSize; i++)
+		smaller[i] = std::move(elements[i]);
+	delete [] elements;
+	elements = smaller;
+	capacity = newCapacity;
+}
+
+/*
+ * maxSize
+ *
+ * Returns: Amount of elements that fit before the set is full
+ */
+template <class Type>
+int StaticSet<Type>::maxSize() const
+{
+	return capacity;
+}
+
 /*
  * add
  *
@@ -128,8 +255,8 @@ bool StaticSet<Type>::remove(const Type& e)
 		if (elements[i] == e) // Found it!
 		{
 			/* Move last element to position i to avoid gaps */
-			elements[i] = elements[currentSize - 1];
-			elements[currentSize - 1] = 0; // "delete" duplicate (might need casting)
+			elements[i] = std::move(elements[currentSize - 1]);
+			elements[currentSize - 1] = Type(); // "delete" duplicate
 			currentSize--;
 			return true;
 		}
@@ -164,7 +291,7 @@ void StaticSet<Type>::clear()
 {
 	/* First clear out the data */
 	for (int i = 0; i < currentSize; i++)
-		elements[i] = 0;
+		elements[i] = Type();
 	/* Now reset currentSize */
 	currentSize = 0;
 }
@@ -203,8 +330,8 @@ int StaticSet<Type>::size() const
 /*
  * asArray
  *
- * Returns: Contents of the set as an array.
- * (Useful due to the lack of an iterator).
+ * Returns: Copy of the contents of the set as an array, which the caller
+ * must delete. To just go through the elements, use begin() and end().
  */
 template <class Type>
 Type* StaticSet<Type>::asArray() const
@@ -217,6 +344,31 @@ Type* StaticSet<Type>::asArray() const
 	/* THINK: Why can't we simply return the elements array? */
 }
 
+/*
+ * begin
+ *
+ * Allows going through the set without copying it, e.g.
+ *     for (const Type& e : set)
+ *
+ * Returns: Iterator to the first element
+ */
+template <class Type>
+typename StaticSet<Type>::const_iterator StaticSet<Type>::begin() const
+{
+	return elements;
+}
+
+/*
+ * end
+ *
+ * Returns: Iterator one past the last element
+ */
+template <class Type>
+typename StaticSet<Type>::const_iterator StaticSet<Type>::end() const
+{
+	return elements + currentSize;
+}
+
 /*
  * isEmpty
  *
@@ -243,17 +395,53 @@ bool StaticSet<Type>::isEmpty() const
 template <class Type>
 std::ostream& operator<<(std::ostream& os, const StaticSet<Type>& set)
 {
-	for (int i = 0; i < set.currentSize; i++)
-		os << set.elements[i] << " ";
+	for (const Type& e : set)
+		os << e << " ";
 	os << "\n";
 
 	return os;
 }
 
+/*
+ * sortedElements
+ *
+ * The elements are kept in no particular order, so the set operations
+ * sort pointers to them instead, and then use binary search. The
+ * elements themselves aren't moved or copied. Type must have operator<.
+ *
+ * Returns: Pointers to the elements, in ascending order
+ */
+template <class Type>
+std::vector<const Type*> StaticSet<Type>::sortedElements() const
+{
+	std::vector<const Type*> sorted(currentSize);
+	for (int i = 0; i < currentSize; i++)
+		sorted[i] = &elements[i];
+	std::sort(sorted.begin(), sorted.end(),
+	          [](const Type* a, const Type* b) { return *a < *b; });
+	return sorted;
+}
+
+/*
+ * contains
+ *
+ * Parameters: sorted - Pointers returned by sortedElements
+ *             e      - Element to look for
+ * Returns: True if e is one of the elements, false otherwise
+ */
+template <class Type>
+bool StaticSet<Type>::contains(const std::vector<const Type*>& sorted, const Type& e)
+{
+	auto found = std::lower_bound(sorted.begin(), sorted.end(), e,
+	                              [](const Type* a, const Type& b) { return *a < b; });
+	return found != sorted.end() && **found == e;
+}
+
 /*
  * setunion
  *
  * Perform the union operation with the specified set.
+ * Takes O((n + m) log n) instead of O(n * m).
  *
  * Parameters: otherSet - Set to perform union with
  * Returns: New set resulting from the union
@@ -262,15 +450,19 @@ template <class Type>
 StaticSet<Type> StaticSet<Type>::setunion(const StaticSet<Type>& otherSet) const
 {
 	StaticSet<Type> result(size() + otherSet.size()); // In case all elements are different
-	/* First we copy this set's elements */
+	/* First we copy this set's elements. They're all different already,
+	 * so there's no need to go through add(). */
 	for (int i = 0; i < size(); i++)
-		result.add(elements[i]);
-	/* Now we copy the other set's elements 
+		result.elements[i] = elements[i];
+	result.currentSize = size();
+	/* Now we copy the other set's elements that aren't in this set
 	 * NOTE: elements is private in the Static Set class, but we're still
 	 *       within the Static Set class, so we can access otherSet.elements
 	 *       The asArray method is for use by other classes/programs, not here. */
+	std::vector<const Type*> sorted = sortedElements();
 	for (int i = 0; i < otherSet.size(); i++)
-		result.add(otherSet.elements[i]); // add() will avoid duplicates
+		if (!contains(sorted, otherSet.elements[i]))
+			result.elements[result.currentSize++] = otherSet.elements[i];
 	return result;
 }
 
@@ -278,6 +470,7 @@ StaticSet<Type> StaticSet<Type>::setunion(const StaticSet<Type>& otherSet) const
  * intersection
  *
  * Perform the intersection operation with the specified set.
+ * Takes O((n + m) log m) instead of O(n * m).
  *
  * Parameters: otherSet - Set to perform intersection with
  * Returns: New set resulting from the intersection
@@ -287,9 +480,10 @@ StaticSet<Type> StaticSet<Type>::intersection(const StaticSet<Type>& otherSet) c
 {
 	StaticSet<Type> result(size()); // could use the size of the smallest of the two sets
 	/* Copy the elements of the first set that are also in the second set. */
+	std::vector<const Type*> sorted = otherSet.sortedElements();
 	for (int i = 0; i < size(); i++)
-		if (otherSet.isElement(elements[i])) // Test if element is in otherSet
-			result.add(elements[i]);
+		if (contains(sorted, elements[i])) // Test if element is in otherSet
+			result.elements[result.currentSize++] = elements[i];
 	return result;
 }
 
@@ -297,6 +491,7 @@ StaticSet<Type> StaticSet<Type>::intersection(const StaticSet<Type>& otherSet) c
  * difference
  *
  * Perform the difference operation with the specified set.
+ * Takes O((n + m) log m) instead of O(n * m).
  *
  * Parameters: otherSet - Set to perform difference with
  * Returns: New set resulting from the difference
@@ -306,9 +501,10 @@ StaticSet<Type> StaticSet<Type>::difference(const StaticSet<Type>& otherSet) con
 {
 	StaticSet<Type> result(size()); // New set can't be bigger than current set
 	/* Copy the elements of the first set that are not in the second set. */
+	std::vector<const Type*> sorted = otherSet.sortedElements();
 	for (int i = 0; i < size(); i++)
-		if (!otherSet.isElement(elements[i])) // Test if element is NOT in otherSet
-			result.add(elements[i]);
+		if (!contains(sorted, elements[i])) // Test if element is NOT in otherSet
+			result.elements[result.currentSize++] = elements[i];
 	return result;
 }
 
@@ -316,6 +512,7 @@ StaticSet<Type> StaticSet<Type>::difference(const StaticSet<Type>& otherSet) con
  * isSubset
  *
  * Determine if set is a subset of another set.
+ * Takes O((n + m) log m) instead of O(n * m).
  *
  * Parameters: otherSet - The set which might contain this set
  * Returns: True if this set is a subset of otherSet, and false otherwise
@@ -323,9 +520,12 @@ StaticSet<Type> StaticSet<Type>::difference(const StaticSet<Type>& otherSet) con
 template <class Type>
 bool StaticSet<Type>::isSubset(const StaticSet<Type>& otherSet) const
 {
+	if (size() > otherSet.size()) // Can't all be there
+		return false;
 	/* Verify whether all elements of the first set are also in second set */
+	std::vector<const Type*> sorted = otherSet.sortedElements();
 	for (int i = 0; i < size(); i++)
-		if (!otherSet.isElement(elements[i]))
+		if (!contains(sorted, elements[i]))
 			return false;
 	/* If we make it here, all elements were found in otherSet */
 	return true;
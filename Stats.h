@@ -0,0 +1,238 @@
+/*****************************************************
+ * Stats.h
+ *
+ * Optional counters and phase timers, to see where
+ * the time of a validation goes. They're only built
+ * when HTMLVALIDATOR_STATS is defined, e.g.
+ *     g++ -DHTMLVALIDATOR_STATS ...
+ * Otherwise every STATS_ macro expands to nothing, so
+ * the hot loops are exactly the same as without them.
+ *
+ * Every thread counts in its own Stats, so counting
+ * needs no locks or atomics; the report adds them up.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef HTMLVALIDATOR_STATS
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+class Stats
+{
+	public:
+		enum Counter
+		{
+			TAGS, // tags read by the tokenizers
+			LOOKUPS, // names looked up in the dictionary
+			PROBES, // extra slots looked at because of collisions
+			PUSHES, // open tags pushed on a stack
+			POPS, // open tags popped from a stack
+			DOCUMENTS, // documents validated
+			BYTES, // bytes of those documents
+			COUNTERS // amount of counters
+		};
+
+		enum Phase
+		{
+			LOAD_DICTIONARY, // reading the tag files (or the built-in tags)
+			READ_FILE, // opening and mapping the documents
+			VALIDATE, // tokenizing, looking up and checking the tags
+			REPORT, // printing the results
+			PHASES // amount of phases
+		};
+
+		Stats(bool = true); // constructor, registers the thread's counters by default
+		~Stats(); // destructor, keeps the counts when the thread ends
+
+		void count(Counter, long long = 1);
+		void depth(int); // note the amount of open tags
+		void time(Phase, std::chrono::steady_clock::duration);
+
+		static Stats& local(); // counters of the calling thread
+		static void report(std::ostream&, bool); // totals of every thread, as text or JSON
+	private:
+		void addTo(Stats&) const;
+
+		long long counts[COUNTERS];
+		long long nanoseconds[PHASES];
+		int maxDepth;
+		bool registered; // counts of a thread, not a total
+
+		static std::mutex& registryLock();
+		static std::vector<Stats*>& registry(); // Stats of the running threads
+		static Stats& finished(); // sum of the threads that ended
+};
+
+/* Times a phase from its construction to the end of its scope */
+class PhaseTimer
+{
+	public:
+		PhaseTimer(Stats::Phase which) : phase(which), start(std::chrono::steady_clock::now()) {}
+		~PhaseTimer() { Stats::local().time(phase, std::chrono::steady_clock::now() - start); }
+	private:
+		Stats::Phase phase;
+		std::chrono::steady_clock::time_point start;
+};
+
+#define STATS_COUNT(counter) Stats::local().count(Stats::counter)
+#define STATS_ADD(counter, amount) Stats::local().count(Stats::counter, (amount))
+#define STATS_DEPTH(openTags) Stats::local().depth(openTags)
+#define STATS_PHASE(phase) PhaseTimer phaseTimer(Stats::phase)
+
+/*
+ * Constructor
+ *
+ * Parameters: threadCounts - True for the counters of a thread, which
+ *                            the report has to find; false for a total
+ */
+inline Stats::Stats(bool threadCounts)
+{
+	for (int i = 0; i < COUNTERS; i++)
+		counts[i] = 0;
+	for (int i = 0; i < PHASES; i++)
+		nanoseconds[i] = 0;
+	maxDepth = 0;
+	registered = threadCounts;
+	if (!registered)
+		return;
+	std::lock_guard<std::mutex> guard(registryLock());
+	registry().push_back(this);
+}
+
+/* Destructor */
+inline Stats::~Stats()
+{
+	if (!registered)
+		return;
+	std::lock_guard<std::mutex> guard(registryLock());
+	addTo(finished());
+	std::vector<Stats*>& running = registry();
+	for (size_t i = 0; i < running.size(); i++)
+		if (running[i] == this)
+		{
+			running.erase(running.begin() + i);
+			break;
+		}
+}
+
+inline std::mutex& Stats::registryLock()
+{
+	static std::mutex lock;
+	return lock;
+}
+
+inline std::vector<Stats*>& Stats::registry()
+{
+	static std::vector<Stats*> running;
+	return running;
+}
+
+inline Stats& Stats::finished()
+{
+	static Stats total(false);
+	return total;
+}
+
+/*
+ * local
+ *
+ * Returns: Stats of the calling thread, created the first time
+ */
+inline Stats& Stats::local()
+{
+	static thread_local Stats stats;
+	return stats;
+}
+
+inline void Stats::count(Counter counter, long long amount)
+{
+	counts[counter] += amount;
+}
+
+inline void Stats::depth(int openTags)
+{
+	if (openTags > maxDepth)
+		maxDepth = openTags;
+}
+
+inline void Stats::time(Phase phase, std::chrono::steady_clock::duration elapsed)
+{
+	nanoseconds[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+/*
+ * addTo
+ *
+ * Adds these counts to a total. The time of a phase is added up over
+ * the threads, so with many threads it can be more than the wall time.
+ *
+ * Parameters: total - Where the counts are added
+ */
+inline void Stats::addTo(Stats& total) const
+{
+	for (int i = 0; i < COUNTERS; i++)
+		total.counts[i] += counts[i];
+	for (int i = 0; i < PHASES; i++)
+		total.nanoseconds[i] += nanoseconds[i];
+	if (maxDepth > total.maxDepth)
+		total.maxDepth = maxDepth;
+}
+
+/*
+ * report
+ *
+ * Prints the totals of every thread, running or ended.
+ *
+ * Parameters: os   - Output stream to use
+ *             json - True for JSON, false for a summary to read
+ */
+inline void Stats::report(std::ostream& os, bool json)
+{
+	static const char *COUNTER_NAMES[COUNTERS] = {"tags", "lookups", "probes", "pushes", "pops", "documents", "bytes"};
+	static const char *PHASE_NAMES[PHASES] = {"load_dictionary", "read_file", "validate", "report"};
+
+	Stats total(false);
+	{
+		std::lock_guard<std::mutex> guard(registryLock());
+		finished().addTo(total);
+		for (size_t i = 0; i < registry().size(); i++)
+			registry()[i]->addTo(total);
+	}
+
+	if (json)
+	{
+		os << "{\"counters\": {";
+		for (int i = 0; i < COUNTERS; i++)
+			os << (i > 0 ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << total.counts[i];
+		os << ", \"max_depth\": " << total.maxDepth << "}, \"seconds\": {";
+		for (int i = 0; i < PHASES; i++)
+			os << (i > 0 ? ", " : "") << "\"" << PHASE_NAMES[i] << "\": " << total.nanoseconds[i] / 1e9;
+		os << "}}\n";
+		return;
+	}
+
+	os << "Counters:\n";
+	for (int i = 0; i < COUNTERS; i++)
+		os << "  " << COUNTER_NAMES[i] << ": " << total.counts[i] << "\n";
+	os << "  max_depth: " << total.maxDepth << "\n";
+	os << "Time per phase (added up over the threads):\n";
+	for (int i = 0; i < PHASES; i++)
+		os << "  " << PHASE_NAMES[i] << ": " << total.nanoseconds[i] / 1e6 << " ms\n";
+}
+
+#else
+
+#define STATS_COUNT(counter) ((void)0)
+#define STATS_ADD(counter, amount) ((void)0)
+#define STATS_DEPTH(openTags) ((void)0)
+#define STATS_PHASE(phase) ((void)0)
+
+#endif
+
+#endif
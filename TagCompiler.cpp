@@ -0,0 +1,126 @@
+/********************************************************
+*   Project: HTML Validator using a stack and two sets
+*   Author: Gustavo A. Rassi
+*********************************************************
+* Description: Compiles tags.txt and self-closing.txt
+*              into TagVocabulary.h, so the validator can
+*              have the tags built in and start without
+*              reading any file (see --builtin).
+*
+*   Usage: TagCompiler [tags.txt] [self-closing.txt] [TagVocabulary.h]
+********************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * readTags
+ *
+ * Reads a tag file, one tag per line. Blank lines and repeated tags
+ * are skipped.
+ *
+ * Parameters: path - Path of the file
+ *             tags - Where the tags are stored
+ * Returns: True if the file could be opened, false otherwise
+ */
+bool readTags(const char* path, vector<string>& tags)
+{
+    ifstream file(path);
+    if(!file.is_open())
+        return false;
+    string tag;
+    while(getline(file, tag))
+    {
+        if(!tag.empty() && tag.back() == '\r') // Files saved on Windows
+            tag.pop_back();
+        bool repeated = tag.empty();
+        for(size_t i = 0; i < tags.size() && !repeated; i++)
+            repeated = (tags[i] == tag);
+        if(!repeated)
+            tags.push_back(tag);
+    }
+    return true;
+}
+
+/*
+ * writeArray
+ *
+ * Writes the tags as a constexpr array of string_views.
+ *
+ * Parameters: out     - Output stream to use
+ *             name    - Name of the array
+ *             comment - Comment above the array
+ *             tags    - Tags to write
+ */
+void writeArray(ostream& out, const char* name, const char* comment, const vector<string>& tags)
+{
+    out << "/* " << comment << " */\n";
+    out << "constexpr std::string_view " << name << "[] = {";
+    size_t width = 80; // Forces a new line before the first tag
+    for(size_t i = 0; i < tags.size(); i++)
+    {
+        string item = "\"" + tags[i] + "\"" + (i + 1 < tags.size() ? "," : "");
+        if(width + item.size() + 1 > 78)
+        {
+            out << "\n\t";
+            width = 4;
+        }
+        else
+        {
+            out << " ";
+            width++;
+        }
+        out << item;
+        width += item.size();
+    }
+    out << "\n};\n";
+}
+
+int main(int argc, char* argv[])
+{
+    const char *tagsPath = argc > 1 ? argv[1] : "tags.txt";
+    const char *selfClosingPath = argc > 2 ? argv[2] : "self-closing.txt";
+    const char *outputPath = argc > 3 ? argv[3] : "TagVocabulary.h";
+
+    vector<string> tags, selfTags;
+    if(!readTags(tagsPath, tags) || !readTags(selfClosingPath, selfTags))
+    {
+        cout << "\nTag files do not exist or have the wrong path\n" << endl;
+        return 1;
+    }
+    for(size_t i = 0; i < tags.size(); i++)
+        for(size_t j = 0; j < tags[i].size(); j++)
+            if(tags[i][j] == '"' || tags[i][j] == '\\')
+            {
+                cout << "\nInvalid tag '" << tags[i] << "'\n" << endl;
+                return 1;
+            }
+
+    ofstream out(outputPath);
+    out << "/*****************************************************\n"
+        << " * TagVocabulary.h\n"
+        << " *\n"
+        << " * Built-in tag vocabulary.\n"
+        << " * GENERATED by TagCompiler from " << tagsPath << " and\n"
+        << " * " << selfClosingPath << ". Don't edit it by hand; run\n"
+        << " * TagCompiler again after changing those files.\n"
+        << " ****************************************************/\n"
+        << "#ifndef TAGVOCABULARY_H\n"
+        << "#define TAGVOCABULARY_H\n\n"
+        << "#include <string_view>\n\n";
+    writeArray(out, "BUILTIN_TAGS", ("Same contents as " + string(tagsPath)).c_str(), tags);
+    out << "\n";
+    writeArray(out, "BUILTIN_SELF_CLOSING", ("Same contents as " + string(selfClosingPath)).c_str(), selfTags);
+    out << "\n#endif\n";
+    if(!out)
+    {
+        cout << "\nCould not write " << outputPath << "\n" << endl;
+        return 1;
+    }
+
+    cout << "Wrote " << tags.size() << " tags (" << selfTags.size() << " self-closing) to " << outputPath << "\n";
+    return 0;
+}
@@ -0,0 +1,341 @@
+/*****************************************************
+ * TagDictionary.h
+ *
+ * Unified dictionary of the tags read from tags.txt
+ * and self-closing.txt. A single hash probe tells
+ * whether a tag is a container, a self-closing
+ * (void) tag or an unknown tag. Tags are found in
+ * any case (<DIV> is <div>).
+ *
+ * Every tag also gets a small integer ID (0, 1, 2...
+ * in the order they were added), so the validator can
+ * store and compare IDs instead of strings.
+ *
+ * Optionally, custom elements (<my-widget>) are
+ * accepted as containers without being listed. They
+ * are only checked for when the probe finds nothing,
+ * so listed tags cost the same single probe. They
+ * all get the same ID, CUSTOM_ID, and the validators
+ * tell them apart by name, so the dictionary never
+ * changes once it's loaded.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef TAGDICTIONARY_H
+#define TAGDICTIONARY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AsciiCase.h"
+#include "ContentModel.h"
+#include "Stats.h"
+#include "TagVocabulary.h" // generated by TagCompiler
+
+enum TagKind
+{
+	UNKNOWN_TAG, // not in any of the tag files
+	CONTAINER_TAG, // must be closed, e.g. <div> ... </div>
+	SELF_CLOSING_TAG // must not be closed, e.g. <br>
+};
+
+class TagDictionary
+{
+	public:
+		TagDictionary(int = DEFAULTAMT); // constructor with default parameter
+
+		void addTag(const std::string&); // add a tag from tags.txt
+		void addSelfClosing(const std::string&); // add a tag from self-closing.txt
+		void addBuiltin(); // add the tags compiled into the program
+		void allowCustomElements(bool = true); // accept <my-widget> and the like as containers
+		bool allowsCustomElements() const;
+		ContentModel& contentModel(); // which tag may be inside which (no rules unless some are added)
+		const ContentModel& contentModel() const;
+		int idOf(std::string_view) const; // ID of a tag, or UNKNOWN_ID
+		TagKind kindOf(int) const; // kind of the tag with that ID
+		TagKind kindOf(std::string_view) const;
+		const std::string& nameOf(int) const; // name of the tag with that ID (not CUSTOM_ID)
+		int size() const; // amount of tags
+		bool isEmpty() const;
+
+		static bool isCustomElementName(std::string_view); // valid name for a custom element
+
+		static const int UNKNOWN_ID = -1; // ID given to tags not in the dictionary
+		static const int CUSTOM_ID = 1 << 24; // ID given to every custom element
+	private:
+		struct Entry
+		{
+			std::string name; // as it was added
+			std::string key; // name in lower case, compared with what's looked up
+			std::uint64_t head; // first 8 bytes of key, so most names take one comparison
+			TagKind kind;
+		};
+
+		int findSlot(std::string_view) const; // slot for the tag (used or empty)
+		void add(const std::string&, TagKind);
+		void grow();
+
+		std::vector<Entry> entries; // the ID of a tag is its position here
+		std::vector<int> index; // open-addressing table of IDs, -1 if empty
+		bool customElements;
+		ContentModel rules;
+		static const int DEFAULTAMT = 128;
+};
+
+/* Constructor */
+inline TagDictionary::TagDictionary(int initialCapacity)
+{
+	if (initialCapacity < 1) // Make sure we get a valid number
+		initialCapacity = DEFAULTAMT;
+	int amtSlots = 1;
+	while (amtSlots < 2 * initialCapacity)
+		amtSlots *= 2;
+	index.assign(amtSlots, -1);
+	entries.reserve(initialCapacity);
+	customElements = false;
+}
+
+/*
+ * findSlot
+ *
+ * Locates the slot of a tag using linear probing.
+ *
+ * Parameters: name - Tag to look for
+ * Returns: Slot holding the tag, or the empty slot where it would go
+ */
+inline int TagDictionary::findSlot(std::string_view name) const
+{
+	int mask = (int)index.size() - 1;
+	std::uint64_t head = AsciiCase::head(name); // Lowered once, for the hash and every comparison
+	int i = (int)(AsciiCase::hash(name, head) & (size_t)mask);
+	while (index[i] != -1)
+	{
+		const Entry& entry = entries[index[i]];
+		if (entry.head == head && entry.key.size() == name.size()
+		    && (name.size() <= 8 || AsciiCase::equals(entry.key, name)))
+			break;
+		i = (i + 1) & mask;
+		STATS_COUNT(PROBES);
+	}
+	return i;
+}
+
+/*
+ * grow
+ *
+ * Doubles the amount of slots and re-inserts every tag.
+ */
+inline void TagDictionary::grow()
+{
+	index.assign(2 * index.size(), -1);
+	for (int e = 0; e < (int)entries.size(); e++)
+		index[findSlot(entries[e].name)] = e;
+}
+
+/*
+ * add
+ *
+ * Add a tag to the dictionary, or update its kind if it's already there.
+ *
+ * Parameters: name - Tag to add
+ *             kind - Kind of the tag
+ */
+inline void TagDictionary::add(const std::string& name, TagKind kind)
+{
+	int slot = findSlot(name);
+	if (index[slot] != -1)
+	{
+		entries[index[slot]].kind = kind;
+		return;
+	}
+	index[slot] = (int)entries.size();
+	std::string key = AsciiCase::lowered(name);
+	entries.push_back({name, key, AsciiCase::head(key), kind});
+	if (2 * entries.size() > index.size()) // keep the table at most half full
+		grow();
+}
+
+/*
+ * addTag
+ *
+ * Add a valid tag. It's a container tag unless it's also self-closing.
+ *
+ * Parameters: name - Tag to add
+ */
+inline void TagDictionary::addTag(const std::string& name)
+{
+	if (index[findSlot(name)] == -1) // Not idOf(): it could take it for a custom element
+		add(name, CONTAINER_TAG);
+}
+
+/*
+ * addSelfClosing
+ *
+ * Add a self-closing tag. It overrides the tag if it was added by addTag.
+ *
+ * Parameters: name - Tag to add
+ */
+inline void TagDictionary::addSelfClosing(const std::string& name)
+{
+	add(name, SELF_CLOSING_TAG);
+}
+
+/*
+ * addBuiltin
+ *
+ * Adds the tags of TagVocabulary.h, the same as reading the tag files
+ * it was compiled from, but without opening any file.
+ */
+inline void TagDictionary::addBuiltin()
+{
+	for (std::string_view tag : BUILTIN_TAGS)
+		addTag(std::string(tag));
+	for (std::string_view tag : BUILTIN_SELF_CLOSING)
+		addSelfClosing(std::string(tag));
+}
+
+/*
+ * allowCustomElements
+ *
+ * Parameters: allow - True to accept any valid custom element name
+ *                     (see isCustomElementName) as a container tag
+ */
+inline void TagDictionary::allowCustomElements(bool allow)
+{
+	customElements = allow;
+}
+
+inline bool TagDictionary::allowsCustomElements() const
+{
+	return customElements;
+}
+
+/*
+ * contentModel
+ *
+ * Returns: Rules of which tag may be right inside which, by tag ID
+ */
+inline ContentModel& TagDictionary::contentModel()
+{
+	return rules;
+}
+
+inline const ContentModel& TagDictionary::contentModel() const
+{
+	return rules;
+}
+
+/*
+ * isCustomElementName
+ *
+ * Follows the HTML standard: an ASCII letter first, at least one '-',
+ * then only letters, digits, '-', '.', '_' or non-ASCII characters,
+ * and none of the names SVG and MathML took. Letters may be in any
+ * case, since HTML lowercases tag names.
+ *
+ * Parameters: name - Tag name
+ * Returns: True if a custom element may have that name
+ */
+inline bool TagDictionary::isCustomElementName(std::string_view name)
+{
+	auto letter = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }; // HTML lowercases them
+	if (name.empty() || !letter(name[0]))
+		return false;
+	bool dash = false;
+	for (char c : name)
+	{
+		if (c == '-')
+			dash = true;
+		else if (!(letter(c) || (c >= '0' && c <= '9') || c == '.' || c == '_' || (unsigned char)c >= 0x80))
+			return false;
+	}
+	static const std::string_view RESERVED[] = {"annotation-xml", "color-profile", "font-face", "font-face-src",
+		"font-face-uri", "font-face-format", "font-face-name", "missing-glyph"};
+	for (std::string_view reserved : RESERVED)
+		if (AsciiCase::equals(reserved, name))
+			return false;
+	return dash;
+}
+
+/*
+ * idOf
+ *
+ * Looks up a tag with a single probe. Only a tag that isn't there is
+ * checked for being a custom element.
+ *
+ * Parameters: name - Tag to look for (without '<', '/' or '>')
+ * Returns: ID of the tag, CUSTOM_ID for a custom element, UNKNOWN_ID
+ *          if it isn't in the dictionary
+ */
+inline int TagDictionary::idOf(std::string_view name) const
+{
+	STATS_COUNT(LOOKUPS);
+	int id = index[findSlot(name)]; // empty slots hold -1 (UNKNOWN_ID)
+	if (id == UNKNOWN_ID && customElements && isCustomElementName(name))
+		return CUSTOM_ID;
+	return id;
+}
+
+/*
+ * kindOf
+ *
+ * Classifies a tag that was already looked up, without hashing again.
+ *
+ * Parameters: id - ID of the tag (may be UNKNOWN_ID)
+ * Returns: Kind of the tag, UNKNOWN_TAG if id is UNKNOWN_ID
+ */
+inline TagKind TagDictionary::kindOf(int id) const
+{
+	if ((unsigned)id < entries.size())
+		return entries[id].kind;
+	return id == CUSTOM_ID ? CONTAINER_TAG : UNKNOWN_TAG; // Custom elements always have content
+}
+
+/*
+ * kindOf
+ *
+ * Classifies a tag with a single lookup.
+ *
+ * Parameters: name - Tag to classify (without '<', '/' or '>')
+ * Returns: Kind of the tag, UNKNOWN_TAG if it isn't in the dictionary
+ */
+inline TagKind TagDictionary::kindOf(std::string_view name) const
+{
+	return kindOf(idOf(name));
+}
+
+/*
+ * nameOf
+ *
+ * Parameters: id - ID of a tag in the dictionary (a custom element's
+ *                  name is only in the document)
+ * Returns: Name of the tag
+ */
+inline const std::string& TagDictionary::nameOf(int id) const
+{
+	return entries[id].name;
+}
+
+/*
+ * size
+ *
+ * Returns: Amount of tags in the dictionary (custom elements aside)
+ */
+inline int TagDictionary::size() const
+{
+	return (int)entries.size();
+}
+
+/*
+ * isEmpty
+ *
+ * Returns: True if the dictionary has no tags, false otherwise
+ */
+inline bool TagDictionary::isEmpty() const
+{
+	return entries.empty();
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*****************************************************
+ * TagVocabulary.h
+ *
+ * Built-in tag vocabulary.
+ * GENERATED by TagCompiler from tags.txt and
+ * self-closing.txt. Don't edit it by hand; run
+ * TagCompiler again after changing those files.
+ ****************************************************/
+#ifndef TAGVOCABULARY_H
+#define TAGVOCABULARY_H
+
+#include <string_view>
+
+/* Same contents as tags.txt */
+constexpr std::string_view BUILTIN_TAGS[] = {
+	"a", "abbr", "address", "area", "article", "aside", "audio", "b", "base",
+	"bdi", "bdo", "blockquote", "body", "br", "button", "canvas", "caption",
+	"cite", "code", "col", "colgroup", "data", "datalist", "dd", "del",
+	"details", "dfn", "dialog", "div", "dl", "dt", "em", "embed", "fieldset",
+	"figcaption", "figure", "footer", "form", "head", "header", "hgroup",
+	"h1", "h2", "h3", "h4", "h5", "h6", "hr", "html", "i", "iframe", "img",
+	"input", "ins", "kbd", "label", "legend", "li", "link", "main", "map",
+	"mark", "menu", "meta", "meter", "nav", "noscript", "object", "ol",
+	"optgroup", "option", "output", "p", "picture", "pre", "progress", "q",
+	"rp", "rt", "ruby", "s", "samp", "script", "section", "select", "slot",
+	"small", "source", "span", "strong", "style", "sub", "summary", "sup",
+	"table", "tbody", "td", "template", "textarea", "tfoot", "th", "thead",
+	"time", "title", "tr", "track", "u", "ul", "var", "video", "wbr"
+};
+
+/* Same contents as self-closing.txt */
+constexpr std::string_view BUILTIN_SELF_CLOSING[] = {
+	"area", "base", "br", "col", "embed", "hr", "iframe", "img", "input",
+	"link", "meta", "source", "template", "track", "wbr"
+};
+
+#endif
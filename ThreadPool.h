@@ -0,0 +1,210 @@
+/*****************************************************
+ * ThreadPool.h
+ *
+ * Work-stealing thread pool. Every worker has its own
+ * queue of tasks; a worker takes the newest task from
+ * its own queue and, when that's empty, steals the
+ * oldest task from another worker's queue. Each task
+ * receives the number of the worker running it, so
+ * per-worker data (e.g. a Validator) can be reused.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+	public:
+		typedef std::function<void(int)> Task; // receives the worker number
+
+		ThreadPool(int = defaultThreads()); // constructor, starts the workers
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool(); // destructor, waits for the tasks and stops the workers
+
+		void submit(Task); // add a task
+		void wait(); // block until every submitted task is done
+		int size() const; // amount of workers
+
+		static int defaultThreads(); // one per core
+	private:
+		struct WorkQueue
+		{
+			std::mutex lock;
+			std::deque<Task> tasks;
+		};
+
+		bool takeTask(int, Task&); // own queue first, then steal
+		void work(int); // loop run by each worker
+
+		std::vector<std::unique_ptr<WorkQueue> > queues; // one per worker
+		std::vector<std::thread> workers;
+		std::mutex stateLock; // protects pending, queued, nextQueue and stopping
+		std::condition_variable taskAdded, allDone;
+		long pending; // tasks submitted but not finished
+		long queued; // tasks in the queues that no worker has reserved yet
+		int nextQueue; // queue that gets the next submitted task
+		bool stopping;
+};
+
+/*
+ * defaultThreads
+ *
+ * Returns: Amount of cores, or 1 if it can't be determined
+ */
+inline int ThreadPool::defaultThreads()
+{
+	int cores = (int)std::thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
+/* Constructor */
+inline ThreadPool::ThreadPool(int threads)
+{
+	if (threads < 1) // Make sure we get a valid number
+		threads = 1;
+	pending = 0;
+	queued = 0;
+	nextQueue = 0;
+	stopping = false;
+	for (int i = 0; i < threads; i++)
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+	for (int i = 0; i < threads; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+/* Destructor */
+inline ThreadPool::~ThreadPool()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		stopping = true;
+	}
+	taskAdded.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+/*
+ * submit
+ *
+ * Adds a task to the queues, round-robin, and wakes up a worker.
+ *
+ * Parameters: task - Task to run
+ */
+inline void ThreadPool::submit(Task task)
+{
+	int target;
+	{
+		std::lock_guard<std::mutex> guard(stateLock);
+		pending++;
+		target = nextQueue;
+		nextQueue = (nextQueue + 1) % (int)queues.size();
+	}
+	{
+		std::lock_guard<std::mutex> guard(queues[target]->lock);
+		queues[target]->tasks.push_back(std::move(task));
+	}
+	{
+		/* Only announce the task once it's really in a queue */
+		std::lock_guard<std::mutex> guard(stateLock);
+		queued++;
+	}
+	taskAdded.notify_one();
+}
+
+/*
+ * takeTask
+ *
+ * Parameters: worker - Number of the worker looking for a task
+ *             task   - Where the task is stored
+ * Returns: True if a task was found, false if all queues are empty
+ */
+inline bool ThreadPool::takeTask(int worker, Task& task)
+{
+	int amount = (int)queues.size();
+	for (int i = 0; i < amount; i++)
+	{
+		WorkQueue& queue = *queues[(worker + i) % amount];
+		std::lock_guard<std::mutex> guard(queue.lock);
+		if (queue.tasks.empty())
+			continue;
+		if (i == 0) // own queue: newest task
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else // someone else's queue: oldest task
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		return true;
+	}
+	return false;
+}
+
+/*
+ * work
+ *
+ * Runs tasks until the pool is destroyed.
+ *
+ * Parameters: worker - Number of this worker
+ */
+inline void ThreadPool::work(int worker)
+{
+	Task task;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> guard(stateLock);
+			taskAdded.wait(guard, [this] { return stopping || queued > 0; });
+			if (queued == 0) // stopping, and nothing left to do
+				return;
+			queued--; // one of the queued tasks is now ours
+		}
+		/* The task we reserved is in some queue; it may take another
+		 * look if another worker grabbed the one we saw first. */
+		while (!takeTask(worker, task))
+			std::this_thread::yield();
+		task(worker);
+		task = nullptr;
+
+		std::lock_guard<std::mutex> guard(stateLock);
+		if (--pending == 0)
+			allDone.notify_all();
+	}
+}
+
+/*
+ * wait
+ *
+ * Blocks until every submitted task has finished.
+ */
+inline void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> guard(stateLock);
+	allDone.wait(guard, [this] { return pending == 0; });
+}
+
+/*
+ * size
+ *
+ * Returns: Amount of workers
+ */
+inline int ThreadPool::size() const
+{
+	return (int)workers.size();
+}
+
+#endif
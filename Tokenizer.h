@@ -0,0 +1,636 @@
+/*****************************************************
+ * Tokenizer.h
+ *
+ * Splits the bytes of an HTML file into tags.
+ * Works directly over the bytes (e.g. a MappedFile),
+ * so tag names are slices of the input and nothing
+ * is copied or allocated. Every tag is looked up in
+ * the dictionary once, here, and comes out with its ID.
+ *
+ * The input may also arrive in chunks of any size
+ * (e.g. from a socket). A tag cut by the end of a
+ * chunk is kept in a small fixed buffer until the
+ * next chunk completes it, so memory use doesn't
+ * depend on the size of the document.
+ *
+ * The tokenizer is a state machine over single bytes,
+ * so it doesn't care about lines: a tag may span many
+ * lines, attribute values in quotes may hold '>', and
+ * comments (<!-- -->) and the text of <script>,
+ * <style>, <textarea> and <title> aren't searched for
+ * tags.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <string_view>
+#include "DelimiterScan.h"
+#include "Stats.h"
+#include "TagDictionary.h"
+
+struct Token
+{
+	std::string_view name; // tag name without '<', '/' or '>'
+	int id; // ID of the tag in the dictionary, or TagDictionary::UNKNOWN_ID
+	bool closing; // true for </name>, false for <name>
+	int line; // line where the tag is
+	long long offset; // position of the '<', counting from the first byte fed
+};
+
+class Tokenizer
+{
+	public:
+		Tokenizer(const TagDictionary&, int = 1); // constructor for chunked input
+		Tokenizer(const TagDictionary&, const char*, const char*, int = 1); // whole input at once
+
+		void reset(int = 1); // start over with a new input
+		void feed(const char*, const char*, bool = false); // next chunk of the input
+		bool next(Token&); // get the next tag
+		int columnOf(const Token&); // column of the '<' of the last tag
+		int lastLine() const; // amount of lines read, counted like getline
+		int currentLine() const; // line of the next byte to read
+		bool betweenTags() const; // true if what was read ends outside of any tag
+
+		static const int MAXNAME = 64; // longest tag name kept across chunks
+		static const int MAXRAW = 8; // longest name of a raw text element ("textarea")
+
+		/* What the tokenizer carries from one line to the next */
+		struct Checkpoint
+		{
+			unsigned char state;
+			char quote;
+			bool rawPending;
+			unsigned char rawLength;
+			char rawName[MAXRAW];
+
+			bool operator==(const Checkpoint&) const;
+			bool operator!=(const Checkpoint& other) const { return !(*this == other); }
+		};
+
+		Checkpoint checkpoint() const; // state at the end of a line
+		void resume(const Checkpoint&, int); // go on from a checkpoint, at that line
+	private:
+		enum State
+		{
+			TEXT, // between tags, looking for '<'
+			TAG_START, // right after '<'
+			BANG, // right after "<!"
+			BANG_DASH, // right after "<!-"
+			TAG_NAME, // reading the name
+			ATTRIBUTES, // after the name, looking for '>' outside of quotes
+			COMMENT, // inside <!-- -->
+			RAW_TEXT, // inside <script> and the like, looking for '<'
+			RAW_END // after a '<' in raw text, matching the closing tag
+		};
+
+		static bool endsName(char); // true for the characters that end a tag name
+		static char lower(char); // ASCII lower case
+		static bool isRawText(std::string_view); // true if no tags are read inside it
+
+		void keepPartial(const char*, const char*); // save part of a cut name
+		bool emit(Token&, std::string_view); // fill in the token for a finished name
+		bool skipToTagEnd(); // go past the attributes and the '>'
+		bool skipComment(); // go past the "-->"
+		bool endChunk(); // remember where the last line of the chunk starts
+
+		const TagDictionary& dictionary;
+		const char *chunkStart; // first byte of the current chunk
+		const char *pos, *end; // part of the current chunk not read yet
+		const char *nameStart; // first byte of the name in the current chunk
+		long long chunkOffset; // bytes fed before the current chunk
+		long long tagOffset; // position of the '<' of the tag being read
+		long long knownLineStart; // position of the first byte of knownLine
+		int knownLine; // last line whose start we know, for columns
+		bool lastChunk; // true if nothing comes after the current chunk
+		bool endsWithNewline; // true if the last byte fed was '\n'
+		int line; // line of pos
+		State state;
+		bool closing; // the tag being read is a closing tag
+		char quote; // where the attributes being read are (see TagEndScanner)
+		int dashes; // '-' in a row just read inside a comment
+		char partial[MAXNAME]; // start of a name cut by the end of a chunk
+		int partialLength;
+		bool partialTooLong; // the cut name didn't fit in partial
+		bool rawPending; // the tag being read starts raw text after its '>'
+		char rawName[MAXRAW]; // name of the element whose raw text we're in
+		int rawLength;
+		int rawMatched; // characters of "/" + rawName matched so far
+		MarkupScanner scan; // finds the next '<' (vectorized when possible)
+		TagEndScanner scanTagEnd; // finds the '>' that ends a tag
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Dictionary used to give each tag its ID
+ *             firstLine     - Line number of the first byte
+ */
+inline Tokenizer::Tokenizer(const TagDictionary& tagDictionary, int firstLine)
+	: dictionary(tagDictionary)
+{
+	scan = bestMarkupScanner();
+	scanTagEnd = bestTagEndScanner();
+	reset(firstLine);
+}
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Dictionary used to give each tag its ID
+ *             first         - First byte to tokenize
+ *             last          - One past the last byte to tokenize
+ *             firstLine     - Line number of the first byte
+ */
+inline Tokenizer::Tokenizer(const TagDictionary& tagDictionary, const char* first, const char* last, int firstLine)
+	: dictionary(tagDictionary)
+{
+	scan = bestMarkupScanner();
+	scanTagEnd = bestTagEndScanner();
+	reset(firstLine);
+	feed(first, last, true);
+}
+
+/*
+ * reset
+ *
+ * Forgets the current input, including any tag cut in half.
+ *
+ * Parameters: firstLine - Line number of the first byte of the new input
+ */
+inline void Tokenizer::reset(int firstLine)
+{
+	chunkStart = pos = end = nameStart = nullptr;
+	chunkOffset = 0;
+	tagOffset = 0;
+	knownLineStart = 0;
+	knownLine = firstLine;
+	lastChunk = false;
+	endsWithNewline = false;
+	line = firstLine;
+	state = TEXT;
+	closing = false;
+	quote = 0;
+	dashes = 0;
+	partialLength = 0;
+	partialTooLong = false;
+	rawPending = false;
+	rawLength = 0;
+	rawMatched = 0;
+}
+
+/*
+ * feed
+ *
+ * Gives the tokenizer the next chunk. The previous chunk must have been
+ * used up (next() returned false) and doesn't need to be kept.
+ *
+ * Parameters: first  - First byte of the chunk
+ *             last   - One past the last byte of the chunk
+ *             isLast - True if this is the end of the input
+ */
+inline void Tokenizer::feed(const char* first, const char* last, bool isLast)
+{
+	chunkOffset += end - chunkStart;
+	chunkStart = pos = nameStart = first;
+	end = last;
+	lastChunk = isLast;
+	if (first != last)
+		endsWithNewline = (last[-1] == '\n');
+}
+
+/*
+ * endsName
+ *
+ * Parameters: c - Character right after some part of a tag name
+ * Returns: True if c isn't part of the name (white space, '/' or '>')
+ */
+inline bool Tokenizer::endsName(char c)
+{
+	return c == '>' || c == '/' || c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f';
+}
+
+/*
+ * lower
+ *
+ * Returns: c in lower case if it's an ASCII letter, c otherwise
+ */
+inline char Tokenizer::lower(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+/*
+ * isRawText
+ *
+ * Everything inside these elements is text, up to their closing tag,
+ * even if it looks like a tag (e.g. "if (a<b)" in a script). This runs
+ * for every tag, so most names are turned down by their length alone.
+ *
+ * Parameters: name - Name of an opening tag
+ * Returns: True if the tag starts raw text, false otherwise
+ */
+inline bool Tokenizer::isRawText(std::string_view name)
+{
+	std::string_view raw;
+	switch (name.size())
+	{
+		case 5:
+			raw = (lower(name[0]) == 's') ? "style" : "title";
+			break;
+		case 6:
+			raw = "script";
+			break;
+		case 8:
+			raw = "textarea";
+			break;
+		default:
+			return false;
+	}
+	for (size_t i = 0; i < raw.size(); i++)
+		if (lower(name[i]) != raw[i])
+			return false;
+	return true;
+}
+
+/*
+ * keepPartial
+ *
+ * Appends part of a name to the partial buffer. Names too long for
+ * the buffer can't be in the dictionary anyway, so the rest is dropped.
+ *
+ * Parameters: first - First character to keep
+ *             last  - One past the last character to keep
+ */
+inline void Tokenizer::keepPartial(const char* first, const char* last)
+{
+	for (; first != last; first++)
+		if (partialLength < MAXNAME)
+			partial[partialLength++] = *first;
+		else
+			partialTooLong = true;
+}
+
+/*
+ * emit
+ *
+ * Fills in the token for a name that just ended. The rest of the tag
+ * (attributes and '>') is skipped by the next call to next().
+ *
+ * Parameters: token - Where the tag is stored
+ *             name  - Name of the tag
+ * Returns: Always true, for convenience
+ */
+inline bool Tokenizer::emit(Token& token, std::string_view name)
+{
+	STATS_COUNT(TAGS);
+	token.name = name;
+	token.id = partialTooLong ? TagDictionary::UNKNOWN_ID : dictionary.idOf(name);
+	token.closing = closing;
+	token.line = line;
+	token.offset = tagOffset;
+	// An unknown tag is reported as invalid, not trusted to start raw text
+	rawPending = !closing && token.id != TagDictionary::UNKNOWN_ID && isRawText(name);
+	if (rawPending)
+	{
+		rawLength = (int)name.size(); // isRawText only knows short names
+		for (int i = 0; i < rawLength; i++)
+			rawName[i] = name[i];
+	}
+	state = ATTRIBUTES;
+	partialLength = 0;
+	partialTooLong = false;
+	return true;
+}
+
+/*
+ * skipToTagEnd
+ *
+ * Skips the attributes of a tag, up to and including its '>'. A '>'
+ * inside a value in quotes doesn't end the tag. Lines are counted, so
+ * a tag can be split over many lines.
+ *
+ * Returns: True once the '>' was found, false if the chunk is used up
+ */
+inline bool Tokenizer::skipToTagEnd()
+{
+	if (pos == end || *pos != '>' || quote != 0) // Most tags have no attributes
+	{
+		pos = scanTagEnd(pos, end, line, quote);
+		if (pos == end)
+			return false;
+	}
+	pos++; // Go past the '>'
+	state = rawPending ? RAW_TEXT : TEXT;
+	return true;
+}
+
+/*
+ * skipComment
+ *
+ * Skips the text of a comment, up to and including its "-->".
+ *
+ * Returns: True once the comment ended, false if the chunk is used up
+ */
+inline bool Tokenizer::skipComment()
+{
+	for (; pos != end; pos++)
+	{
+		char c = *pos;
+		if (c == '-')
+			dashes++;
+		else if (c == '>' && dashes >= 2)
+		{
+			pos++;
+			state = TEXT;
+			return true;
+		}
+		else
+		{
+			dashes = 0;
+			if (c == '\n')
+				line++;
+		}
+	}
+	return false;
+}
+
+/*
+ * next
+ *
+ * Finds the next tag. Text, comments, attributes and the text of raw
+ * text elements are skipped. The name of the tag ends at white space,
+ * '/' or '>'. The name stays valid until the next call to next() or feed().
+ *
+ * Parameters: token - Where the tag is stored
+ * Returns: True if a tag was found, false if the chunk is used up
+ */
+inline bool Tokenizer::next(Token& token)
+{
+	while (true)
+		switch (state)
+		{
+			case TEXT:
+				// Skip the text until we meet a '<', counting its lines
+				pos = scan(pos, end, line);
+				if (pos == end)
+					return endChunk();
+				tagOffset = chunkOffset + (pos - chunkStart);
+				pos++; // Go past the '<'
+				state = TAG_START;
+				break;
+
+			case TAG_START:
+				closing = false;
+				if (pos == end) // Can't tell yet what kind of tag it is
+				{
+					if (lastChunk) // '<' was the last character
+						return emit(token, std::string_view());
+					return endChunk();
+				}
+				if (*pos == '!')
+				{
+					pos++;
+					state = BANG;
+					break;
+				}
+				closing = (*pos == '/');
+				if (closing)
+					pos++; // Go past the '/' as well
+				nameStart = pos;
+				state = TAG_NAME;
+				break;
+
+			case BANG:
+			case BANG_DASH:
+			{
+				if (pos == end && !lastChunk)
+					return endChunk();
+				if (pos != end && *pos == '-')
+				{
+					pos++;
+					if (state == BANG)
+						state = BANG_DASH;
+					else // "<!--" starts a comment
+					{
+						dashes = 2; // So "<!-->" is a whole (empty) comment
+						state = COMMENT;
+					}
+					break;
+				}
+				// Not a comment (e.g. <!DOCTYPE>), so "!" or "!-" starts the name
+				static const char MARKUP[] = "!-";
+				keepPartial(MARKUP, MARKUP + (state == BANG ? 1 : 2));
+				nameStart = pos;
+				state = TAG_NAME;
+				break;
+			}
+
+			case TAG_NAME:
+			{
+				/* Tag names are only a few characters long, so a plain
+				 * loop is faster here than setting up vector compares. */
+				while (pos != end && !endsName(*pos))
+					pos++;
+
+				if (pos == end && !lastChunk) // The name may go on in the next chunk
+				{
+					keepPartial(nameStart, pos);
+					return endChunk();
+				}
+
+				std::string_view finished(nameStart, pos - nameStart);
+				if (partialLength > 0 || partialTooLong) // Name started in an earlier chunk
+				{
+					keepPartial(nameStart, pos);
+					finished = std::string_view(partial, partialLength);
+				}
+				return emit(token, finished); // '>' is left for skipToTagEnd
+			}
+
+			case ATTRIBUTES:
+				if (!skipToTagEnd())
+					return endChunk();
+				break;
+
+			case COMMENT:
+				if (!skipComment())
+					return endChunk();
+				break;
+
+			case RAW_TEXT:
+				// Only a '<' may start the closing tag, so skip to it at full speed
+				pos = scan(pos, end, line);
+				if (pos == end)
+					return endChunk();
+				tagOffset = chunkOffset + (pos - chunkStart);
+				pos++;
+				rawMatched = 0;
+				state = RAW_END;
+				break;
+
+			case RAW_END:
+				// Match "/name", ignoring case, one character at a time
+				while (pos != end && rawMatched <= rawLength
+				       && lower(*pos) == lower(rawMatched == 0 ? '/' : rawName[rawMatched - 1]))
+				{
+					pos++;
+					rawMatched++;
+				}
+				if (pos == end && !lastChunk)
+					return endChunk();
+				if (pos != end && rawMatched > rawLength && endsName(*pos))
+				{
+					closing = true;
+					return emit(token, std::string_view(rawName, rawLength));
+				}
+				// Still raw text; *pos may be a '<' or a '\n', so don't skip it
+				state = RAW_TEXT;
+				break;
+		}
+}
+
+/*
+ * endChunk
+ *
+ * Called once the chunk is used up, while its bytes are still there.
+ * Remembers where the last line of the chunk starts, so columnOf works
+ * for tags whose line began in an earlier chunk.
+ *
+ * Returns: Always false (no more tags in this chunk), for convenience
+ */
+inline bool Tokenizer::endChunk()
+{
+	const char *lineStart = end;
+	while (lineStart != chunkStart && lineStart[-1] != '\n')
+		lineStart--;
+	if (lineStart != chunkStart) // There's a '\n' in the chunk
+	{
+		knownLine = line;
+		knownLineStart = chunkOffset + (lineStart - chunkStart);
+	}
+	return false;
+}
+
+/*
+ * columnOf
+ *
+ * Finds the column of a tag. Columns are only needed for errors, so
+ * they're worked out here instead of for every tag. Must be called
+ * before the next call to next() or feed().
+ *
+ * Parameters: token - Last tag returned by next()
+ * Returns: Column of the '<' of the tag, starting at 1
+ */
+inline int Tokenizer::columnOf(const Token& token)
+{
+	if (token.line != knownLine)
+	{
+		/* The line started after the last known line start, so its '\n'
+		 * is in this chunk, before the '<'. Look for it backwards. */
+		const char *lineStart = chunkStart + (token.offset - chunkOffset);
+		while (lineStart != chunkStart && lineStart[-1] != '\n')
+			lineStart--;
+		knownLine = token.line;
+		knownLineStart = chunkOffset + (lineStart - chunkStart);
+	}
+	return (int)(token.offset - knownLineStart) + 1;
+}
+
+/*
+ * lastLine
+ *
+ * Returns: Number of the last line read. A '\n' at the very end
+ *          doesn't start a new line, the same as with getline.
+ */
+inline int Tokenizer::lastLine() const
+{
+	if (endsWithNewline)
+		return line - 1;
+	return line;
+}
+
+/*
+ * currentLine
+ *
+ * Returns: Line of the next byte fed. Unlike lastLine, a '\n' at the
+ *          end of what was read counts as the start of a new line.
+ */
+inline int Tokenizer::currentLine() const
+{
+	return line;
+}
+
+/*
+ * betweenTags
+ *
+ * Tells if the tokenizer is in plain text, where a new tokenizer would
+ * be too. Input split right before a '<' can then be read by separate
+ * tokenizers and give the same tags.
+ *
+ * Returns: True if the bytes read so far end outside of any tag, comment
+ *          or raw text, false otherwise
+ */
+inline bool Tokenizer::betweenTags() const
+{
+	return state == TEXT;
+}
+
+/*
+ * checkpoint
+ *
+ * Saves the state between two lines, so tokenizing can go on from there
+ * later (e.g. after the lines that follow were edited). Only valid right
+ * after a chunk that ends with '\n' was used up: a name can't go on past
+ * a line, so nothing but this is left over.
+ *
+ * Returns: State of the tokenizer
+ */
+inline Tokenizer::Checkpoint Tokenizer::checkpoint() const
+{
+	Checkpoint saved = {(unsigned char)state, quote, rawPending, 0, {}};
+	if (rawPending || state == RAW_TEXT || state == RAW_END) // Otherwise the name is left over from before
+	{
+		saved.rawLength = (unsigned char)rawLength;
+		for (int i = 0; i < rawLength; i++)
+			saved.rawName[i] = rawName[i];
+	}
+	return saved;
+}
+
+/*
+ * resume
+ *
+ * Starts over with a new input that goes on from a checkpoint.
+ *
+ * Parameters: saved     - State saved by checkpoint()
+ *             firstLine - Line number of the first byte of the new input
+ */
+inline void Tokenizer::resume(const Checkpoint& saved, int firstLine)
+{
+	reset(firstLine);
+	state = (State)saved.state;
+	quote = saved.quote;
+	rawPending = saved.rawPending;
+	rawLength = saved.rawLength;
+	for (int i = 0; i < rawLength; i++)
+		rawName[i] = saved.rawName[i];
+}
+
+/*
+ * operator==
+ *
+ * Returns: True if tokenizing goes on the same way from both checkpoints
+ */
+inline bool Tokenizer::Checkpoint::operator==(const Checkpoint& other) const
+{
+	if (state != other.state || quote != other.quote || rawPending != other.rawPending || rawLength != other.rawLength)
+		return false;
+	for (int i = 0; i < rawLength; i++)
+		if (lower(rawName[i]) != lower(other.rawName[i]))
+			return false;
+	return true;
+}
+
+#endif
@@ -0,0 +1,438 @@
+/*****************************************************
+ * ValidationCache.h
+ *
+ * Remembers the results of earlier validations in a
+ * file, so documents that didn't change aren't
+ * validated again. A result is kept by the hash of
+ * the document's contents; the path, size and time
+ * of the file are kept too, so a file that wasn't
+ * touched isn't even read.
+ *
+ * The whole cache is thrown away when the tags (or
+ * the amount of errors collected) change, since its
+ * results would be out of date.
+ *
+ * Many programs may share the cache file: saving
+ * merges with what's on disk under a lock, and the
+ * new file replaces the old one in a single rename,
+ * so readers never see half a file.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef VALIDATIONCACHE_H
+#define VALIDATIONCACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "Stats.h"
+#include "TagDictionary.h"
+#include "Validator.h"
+
+struct FileStamp
+{
+	long long size;
+	long long modified; // last change, in nanoseconds
+};
+
+/* What a validation found out, to be added to the cache afterwards */
+struct CacheUpdate
+{
+	std::string path; // empty if there's nothing to add
+	FileStamp stamp;
+	std::uint64_t hash; // of the contents
+	bool validated; // result is new (false if another path had the same contents)
+	ValidationResult result;
+};
+
+class ValidationCache
+{
+	public:
+		ValidationCache(const TagDictionary&, int = 1); // constructor, for results with that many errors
+
+		bool load(const char*); // read a cache file
+		bool save(const char*); // merge with the file and replace it
+		template <class AnyValidator>
+		ValidationResult validateFile(AnyValidator&, const std::string&, CacheUpdate&) const;
+		void add(const CacheUpdate&); // keep what validateFile found out
+
+		static bool stampOf(const std::string&, FileStamp&); // size and time of a file
+	private:
+		struct PathEntry
+		{
+			FileStamp stamp;
+			std::uint64_t hash;
+		};
+
+		bool read(const char*, std::unordered_map<std::string, PathEntry>&,
+			std::unordered_map<std::uint64_t, ValidationResult>&) const;
+		std::string serialize() const;
+
+		std::uint64_t fingerprint; // of the tags and the error limit
+		std::unordered_map<std::string, PathEntry> paths;
+		std::unordered_map<std::uint64_t, ValidationResult> results; // by hash of the contents
+		static const std::uint32_t MAGIC = 0x31435648; // "HVC1"
+};
+
+/*
+ * Constructor
+ *
+ * Parameters: dictionary - Tags (and content model) the results are for
+ *             maxErrors  - Amount of errors the results collect
+ */
+inline ValidationCache::ValidationCache(const TagDictionary& dictionary, int maxErrors)
+{
+	std::string tags;
+	for (int id = 0; id < dictionary.size(); id++)
+	{
+		tags += dictionary.nameOf(id);
+		tags += (char)('0' + dictionary.kindOf(id));
+		tags += '\n';
+	}
+	if (dictionary.allowsCustomElements())
+		tags += "custom elements\n";
+	fingerprint = contentHash(tags.data(), tags.size(), (std::uint64_t)maxErrors ^ dictionary.contentModel().hash());
+}
+
+/*
+ * stampOf
+ *
+ * Parameters: path  - Path of the file
+ *             stamp - Where the size and the time of its last change go
+ * Returns: True if the file exists, false otherwise
+ */
+inline bool ValidationCache::stampOf(const std::string& path, FileStamp& stamp)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	stamp.size = (long long)info.st_size;
+#if defined(__APPLE__)
+	stamp.modified = (long long)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+	stamp.modified = (long long)info.st_mtime * 1000000000;
+#else
+	stamp.modified = (long long)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+/*
+ * Helpers to write and read the cache file. Numbers are stored in
+ * little-endian order whatever the machine, strings with their length.
+ */
+namespace CacheFormat
+{
+	inline void putNumber(std::string& out, std::uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+			out += (char)((value >> (8 * i)) & 0xFF);
+	}
+
+	inline void putText(std::string& out, const std::string& text)
+	{
+		putNumber(out, text.size(), 4);
+		out += text;
+	}
+
+	struct Reader
+	{
+		const char *pos, *end;
+		bool failed; // ran past the end
+
+		std::uint64_t number(int bytes)
+		{
+			if (end - pos < bytes)
+			{
+				failed = true;
+				pos = end;
+				return 0;
+			}
+			std::uint64_t value = 0;
+			for (int i = 0; i < bytes; i++)
+				value |= (std::uint64_t)(unsigned char)pos[i] << (8 * i);
+			pos += bytes;
+			return value;
+		}
+
+		std::string text()
+		{
+			std::uint64_t length = number(4);
+			if ((std::uint64_t)(end - pos) < length)
+			{
+				failed = true;
+				pos = end;
+				return std::string();
+			}
+			std::string value(pos, (std::size_t)length);
+			pos += length;
+			return value;
+		}
+	};
+
+	inline void putError(std::string& out, const ValidationError& error)
+	{
+		putNumber(out, error.status, 1);
+		putNumber(out, (std::uint32_t)error.line, 4);
+		putNumber(out, (std::uint32_t)error.column, 4);
+		putText(out, error.tag);
+		putText(out, error.expected);
+	}
+
+	inline void getError(Reader& in, ValidationError& error)
+	{
+		error.status = (ValidationStatus)in.number(1);
+		error.line = (int)(std::int32_t)in.number(4);
+		error.column = (int)(std::int32_t)in.number(4);
+		error.tag = in.text();
+		error.expected = in.text();
+	}
+}
+
+/*
+ * serialize
+ *
+ * The file is the magic number, the fingerprint, then the results (each
+ * one once, by hash) and the paths that lead to them.
+ *
+ * Returns: Contents of the cache file
+ */
+inline std::string ValidationCache::serialize() const
+{
+	using namespace CacheFormat;
+	std::string out;
+	putNumber(out, MAGIC, 4);
+	putNumber(out, fingerprint, 8);
+
+	putNumber(out, results.size(), 4);
+	for (const auto& entry : results)
+	{
+		const ValidationResult& result = entry.second;
+		putNumber(out, entry.first, 8);
+		putError(out, result);
+		putNumber(out, result.truncated, 1);
+		putNumber(out, result.errors.size(), 4);
+		for (const ValidationError& error : result.errors)
+			putError(out, error);
+	}
+
+	putNumber(out, paths.size(), 4);
+	for (const auto& entry : paths)
+	{
+		putText(out, entry.first);
+		putNumber(out, (std::uint64_t)entry.second.stamp.size, 8);
+		putNumber(out, (std::uint64_t)entry.second.stamp.modified, 8);
+		putNumber(out, entry.second.hash, 8);
+	}
+	return out;
+}
+
+/*
+ * read
+ *
+ * Reads a cache file into the given tables. Anything wrong with the file
+ * (missing, cut short, other tags) leaves them as they were.
+ *
+ * Parameters: file       - Path of the cache file
+ *             pathTable  - Where the paths go
+ *             hashTable  - Where the results go
+ * Returns: True if the file was read, false otherwise
+ */
+inline bool ValidationCache::read(const char* file, std::unordered_map<std::string, PathEntry>& pathTable,
+	std::unordered_map<std::uint64_t, ValidationResult>& hashTable) const
+{
+	using namespace CacheFormat;
+	std::ifstream in(file, std::ios::binary);
+	if (!in.is_open())
+		return false;
+	std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	Reader reader = {bytes.data(), bytes.data() + bytes.size(), false};
+	if (reader.number(4) != MAGIC || reader.number(8) != fingerprint)
+		return false; // Not a cache, or the tags changed
+
+	std::unordered_map<std::string, PathEntry> newPaths;
+	std::unordered_map<std::uint64_t, ValidationResult> newResults;
+	std::uint64_t amount = reader.number(4);
+	for (std::uint64_t i = 0; i < amount && !reader.failed; i++)
+	{
+		std::uint64_t hash = reader.number(8);
+		ValidationResult result;
+		getError(reader, result);
+		result.truncated = reader.number(1) != 0;
+		std::uint64_t errors = reader.number(4);
+		for (std::uint64_t e = 0; e < errors && !reader.failed; e++)
+		{
+			ValidationError error;
+			getError(reader, error);
+			result.errors.push_back(std::move(error));
+		}
+		newResults[hash] = std::move(result);
+	}
+	amount = reader.number(4);
+	for (std::uint64_t i = 0; i < amount && !reader.failed; i++)
+	{
+		std::string path = reader.text();
+		PathEntry entry;
+		entry.stamp.size = (long long)reader.number(8);
+		entry.stamp.modified = (long long)reader.number(8);
+		entry.hash = reader.number(8);
+		newPaths[path] = entry;
+	}
+	if (reader.failed || reader.pos != reader.end)
+		return false;
+
+	// What's already in the tables is newer, so it stays
+	pathTable.insert(newPaths.begin(), newPaths.end());
+	hashTable.insert(newResults.begin(), newResults.end());
+	return true;
+}
+
+/*
+ * load
+ *
+ * Parameters: file - Path of the cache file
+ * Returns: True if the cache was read, false if it's missing or out of
+ *          date (the cache then starts empty)
+ */
+inline bool ValidationCache::load(const char* file)
+{
+	return read(file, paths, results);
+}
+
+/*
+ * save
+ *
+ * Writes the cache. Another program may have saved the same file since
+ * it was loaded, so the file is read again and merged (under a lock)
+ * before being replaced. Paths to files that are gone are dropped, and
+ * so are the results no path leads to.
+ *
+ * Parameters: file - Path of the cache file
+ * Returns: True if it was saved, false otherwise
+ */
+inline bool ValidationCache::save(const char* file)
+{
+	std::string target(file);
+#if !defined(_WIN32)
+	int lock = open((target + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+	if (lock >= 0)
+		flock(lock, LOCK_EX); // Released when closed
+#endif
+	read(file, paths, results);
+
+	std::unordered_map<std::uint64_t, ValidationResult> used;
+	for (auto it = paths.begin(); it != paths.end(); )
+	{
+		FileStamp stamp;
+		auto result = results.find(it->second.hash);
+		if (result == results.end() || !stampOf(it->first, stamp))
+			it = paths.erase(it);
+		else
+		{
+			used.insert(*result);
+			++it;
+		}
+	}
+	results.swap(used);
+
+	std::string temporary = target + ".tmp";
+#if !defined(_WIN32)
+	temporary += std::to_string(getpid()); // Unique among the writers
+#endif
+	bool saved;
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out << serialize();
+		saved = out.good();
+	}
+	saved = saved && std::rename(temporary.c_str(), file) == 0;
+	if (!saved)
+		std::remove(temporary.c_str());
+#if !defined(_WIN32)
+	if (lock >= 0)
+		close(lock);
+#endif
+	return saved;
+}
+
+/*
+ * validateFile
+ *
+ * Gets the result of a file from the cache, or validates it. Only reads
+ * the cache, so many threads can call it at once; what it finds out is
+ * left in update, to be added later with add().
+ *
+ * Parameters: validator - Validates the file if it isn't in the cache
+ *             path      - Path of the HTML file
+ *             update    - Where the new information goes
+ * Returns: Result of the validation
+ */
+template <class AnyValidator>
+ValidationResult ValidationCache::validateFile(AnyValidator& validator, const std::string& path, CacheUpdate& update) const
+{
+	update.path.clear();
+	update.validated = false;
+	FileStamp stamp;
+	if (!stampOf(path, stamp))
+		return validator.validateFile(path.c_str()); // Reports the missing file
+
+	// Not touched since it was validated: no need to even read it
+	auto known = paths.find(path);
+	if (known != paths.end() && known->second.stamp.size == stamp.size
+	    && known->second.stamp.modified == stamp.modified)
+	{
+		auto result = results.find(known->second.hash);
+		if (result != results.end())
+			return result->second;
+	}
+
+	MappedFile import; // Link with the HTML file, without copying it
+	{
+		STATS_PHASE(READ_FILE);
+		if (!import.open(path.c_str()))
+			return validator.validateFile(path.c_str());
+	}
+	Compression compression = compressionOf(import.data(), import.size());
+	if (!canDecompress(compression)) // Not kept, so a build that can read it doesn't get the old result
+		return validator.validateFile(path.c_str());
+	update.path = path;
+	update.stamp = stamp;
+	update.hash = contentHash(import.data(), import.size());
+	auto same = results.find(update.hash); // Touched, or another copy, but the same contents
+	if (same != results.end())
+		return same->second;
+	if (compression != UNCOMPRESSED) // Kept by the hash of the compressed bytes
+		update.result = validator.validateFile(path.c_str());
+	else
+		update.result = validator.validate(import.data(), import.data() + import.size());
+	update.validated = true;
+	return update.result;
+}
+
+/*
+ * add
+ *
+ * Parameters: update - What a call to validateFile found out
+ */
+inline void ValidationCache::add(const CacheUpdate& update)
+{
+	if (update.path.empty()) // Nothing new (or no file)
+		return;
+	paths[update.path] = {update.stamp, update.hash};
+	if (update.validated)
+		results[update.hash] = update.result;
+}
+
+#endif
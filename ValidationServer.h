@@ -0,0 +1,540 @@
+/*****************************************************
+ * ValidationServer.h
+ *
+ * Keeps the validator running, listening on a Unix
+ * domain socket, so the tags are loaded once instead
+ * of once per file. Meant for many small documents,
+ * where starting a process costs more than
+ * validating.
+ *
+ * A request is a document preceded by its length;
+ * the response is a JSON object with the result,
+ * preceded by its length too. Lengths are 4 bytes,
+ * little-endian. A client may send many requests on
+ * the same connection; the responses come back in
+ * the same order.
+ *
+ * One thread waits on every connection at once
+ * (epoll), and the documents are validated by a
+ * ThreadPool, one Validator per worker. Linux only.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef VALIDATIONSERVER_H
+#define VALIDATIONSERVER_H
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "TagDictionary.h"
+#include "ReportWriter.h"
+#include "ThreadPool.h"
+#include "Validator.h"
+
+class ValidationServer
+{
+	public:
+		ValidationServer(const TagDictionary&, int = ThreadPool::defaultThreads(), int = 1);
+		ValidationServer(const ValidationServer&) = delete;
+		ValidationServer& operator=(const ValidationServer&) = delete;
+
+		int run(const char*); // serve until stopped by a signal
+		static void stop(); // make run() return (safe in a signal handler)
+
+		static const std::uint32_t MAXDOCUMENT = 64 << 20; // longest document accepted
+		static const std::size_t MAXQUEUED = 8; // documents waiting per connection before reading stops
+		static const std::size_t MAXQUEUEDBYTES = 4 << 20; // bytes of them before reading stops
+	private:
+		struct Connection
+		{
+			std::uint64_t id; // connections are known by number, never reused
+			int socket;
+			std::string input; // bytes received and not handled yet
+			std::size_t parsed; // bytes of input already taken as documents
+			std::deque<std::string> waiting; // documents after the one being validated
+			std::size_t waitingBytes; // bytes of those documents
+			bool validating; // a document of this connection is in the pool
+			std::string output; // response bytes not sent yet
+			std::uint32_t watched; // epoll events asked for
+			bool closing; // the client sent everything; close when done
+			bool rejected; // sent a document too large; told so after the others
+		};
+
+		bool listenOn(const char*); // create the socket
+		void accept(); // take every waiting connection
+		void receive(Connection&); // read what the client sent
+		void split(Connection&); // take the documents that arrived whole
+		static bool queueFull(const Connection&); // stop reading until some documents are done
+		void send(Connection&); // write what's waiting
+		void validateNext(Connection&); // give the pool the next document
+		void collect(); // hand out the responses of the pool
+		void update(Connection&); // close it if it's done, or watch what it needs
+		void close(std::uint64_t); // forget a connection
+
+		static std::string frame(const std::string&); // prefix with the length
+		static int& wakeDescriptor(); // eventfd that interrupts epoll
+
+		const TagDictionary& dictionary;
+		int maxErrors;
+		ThreadPool pool;
+		std::vector<Validator> validators; // one per worker
+		int listener, events;
+		std::uint64_t nextId; // number of the next connection
+		std::unordered_map<std::uint64_t, Connection> connections;
+		std::mutex finishedLock; // protects finished
+		std::vector<std::pair<std::uint64_t, std::string> > finished; // responses from the pool
+		static volatile std::sig_atomic_t stopping;
+};
+
+inline volatile std::sig_atomic_t ValidationServer::stopping = 0;
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Tags, loaded once for every request
+ *             threads       - Amount of workers validating documents
+ *             errorLimit    - Errors to collect per document
+ */
+inline ValidationServer::ValidationServer(const TagDictionary& tagDictionary, int threads, int errorLimit)
+	: dictionary(tagDictionary), maxErrors(errorLimit), pool(threads),
+	  validators(pool.size(), Validator(tagDictionary, errorLimit))
+{
+	listener = events = -1;
+	nextId = 1;
+}
+
+inline int& ValidationServer::wakeDescriptor()
+{
+	static int descriptor = -1;
+	return descriptor;
+}
+
+/*
+ * stop
+ *
+ * Asks the server to stop. Only sets a flag and writes to the eventfd,
+ * so it can be called from a signal handler.
+ */
+inline void ValidationServer::stop()
+{
+	stopping = 1;
+	std::uint64_t one = 1;
+	if (wakeDescriptor() >= 0 && write(wakeDescriptor(), &one, sizeof one) < 0)
+		return; // Full counter: it's awake anyway
+}
+
+/*
+ * frame
+ *
+ * Parameters: payload - Bytes to send
+ * Returns: The bytes preceded by their length, 4 bytes little-endian
+ */
+inline std::string ValidationServer::frame(const std::string& payload)
+{
+	std::string out(4, '\0');
+	for (int i = 0; i < 4; i++)
+		out[i] = (char)((payload.size() >> (8 * i)) & 0xFF);
+	return out + payload;
+}
+
+/*
+ * listenOn
+ *
+ * Parameters: path - Path of the socket. A socket left there by a server
+ *                    that didn't stop cleanly is replaced; anything else
+ *                    (a file, a server still running) is left alone
+ * Returns: True if the server is listening, false otherwise
+ */
+inline bool ValidationServer::listenOn(const char* path)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof address);
+	address.sun_family = AF_UNIX;
+	if (std::strlen(path) >= sizeof address.sun_path)
+	{
+		std::cerr << "Socket path is too long: " << path << "\n";
+		return false;
+	}
+	std::strcpy(address.sun_path, path);
+
+	struct stat info;
+	if (lstat(path, &info) == 0)
+	{
+		if (!S_ISSOCK(info.st_mode))
+		{
+			std::cerr << "Can't listen on " << path << ": it exists and isn't a socket\n";
+			return false;
+		}
+		/* Only a socket nobody listens on is left over; connecting to it
+		 * is refused. Anything else means a server is still using it. */
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		bool stale = probe >= 0 && connect(probe, (sockaddr *)&address, sizeof address) != 0 && errno == ECONNREFUSED;
+		if (probe >= 0)
+			::close(probe);
+		if (!stale)
+		{
+			std::cerr << "Can't listen on " << path << ": another server is using it\n";
+			return false;
+		}
+		unlink(path);
+	}
+
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener < 0)
+		return false;
+	if (bind(listener, (sockaddr *)&address, sizeof address) != 0 || listen(listener, SOMAXCONN) != 0)
+	{
+		std::cerr << "Can't listen on " << path << ": " << std::strerror(errno) << "\n";
+		return false;
+	}
+	return true;
+}
+
+/*
+ * update
+ *
+ * Closes a connection that has nothing left to do. Otherwise tells
+ * epoll to wake up for its input (unless the client is done sending or
+ * enough of its documents are waiting already), and for room to write
+ * when there's output waiting.
+ *
+ * Parameters: connection - Connection that may have changed
+ */
+inline void ValidationServer::update(Connection& connection)
+{
+	if (connection.closing && !connection.validating && connection.output.empty())
+	{
+		close(connection.id);
+		return;
+	}
+	bool reading = !connection.closing && !queueFull(connection);
+	std::uint32_t wanted = (reading ? (std::uint32_t)EPOLLIN : 0u) | (connection.output.empty() ? 0u : (std::uint32_t)EPOLLOUT);
+	if (wanted == connection.watched)
+		return;
+	epoll_event event;
+	std::memset(&event, 0, sizeof event);
+	event.events = wanted;
+	event.data.u64 = connection.id;
+	epoll_ctl(events, EPOLL_CTL_MOD, connection.socket, &event);
+	connection.watched = wanted;
+}
+
+/*
+ * accept
+ *
+ * Takes every connection that's waiting to be accepted.
+ */
+inline void ValidationServer::accept()
+{
+	while (true)
+	{
+		int client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (client < 0)
+			return; // No more for now (or too many open files: try again later)
+		std::uint64_t id = nextId++;
+		Connection& connection = connections[id];
+		connection.id = id;
+		connection.socket = client;
+		connection.parsed = 0;
+		connection.waitingBytes = 0;
+		connection.validating = false;
+		connection.watched = EPOLLIN;
+		connection.closing = false;
+		connection.rejected = false;
+
+		epoll_event event;
+		std::memset(&event, 0, sizeof event);
+		event.events = EPOLLIN;
+		event.data.u64 = id;
+		epoll_ctl(events, EPOLL_CTL_ADD, client, &event);
+	}
+}
+
+/*
+ * validateNext
+ *
+ * Gives the pool the next document of a connection, unless one of its
+ * documents is still being validated (so the responses stay in order).
+ *
+ * Parameters: connection - The connection
+ */
+inline void ValidationServer::validateNext(Connection& connection)
+{
+	if (connection.validating)
+		return;
+	if (connection.waiting.empty())
+	{
+		if (connection.rejected) // Answered after everything sent before it
+			connection.output += frame("{\"error\": \"document too large\"}");
+		connection.rejected = false;
+		return;
+	}
+	connection.validating = true;
+	std::uint64_t id = connection.id;
+	std::string document = std::move(connection.waiting.front());
+	connection.waiting.pop_front();
+	connection.waitingBytes -= document.size();
+	pool.submit([this, id, document = std::move(document)](int worker) {
+		ValidationResult result = validators[worker].validate(document.data(), document.data() + document.size());
+		std::string response = frame(resultJson(result));
+		{
+			std::lock_guard<std::mutex> guard(finishedLock);
+			finished.emplace_back(id, std::move(response));
+		}
+		std::uint64_t one = 1;
+		if (write(wakeDescriptor(), &one, sizeof one) < 0)
+			return; // Full counter: it's awake anyway
+	});
+}
+
+/*
+ * queueFull
+ *
+ * A client may send many documents without waiting for the responses.
+ * Past a few of them (or when it doesn't read the responses), the rest
+ * is left in the socket, so the client waits, until the ones already
+ * read are validated and answered.
+ *
+ * Parameters: connection - The connection
+ * Returns: True if no more should be read for now
+ */
+inline bool ValidationServer::queueFull(const Connection& connection)
+{
+	return connection.waiting.size() >= MAXQUEUED || connection.waitingBytes >= MAXQUEUEDBYTES
+	       || connection.output.size() >= MAXQUEUEDBYTES; // Not reading its responses
+}
+
+/*
+ * receive
+ *
+ * Reads what the client sent and splits it into documents, until the
+ * queue of the connection is full.
+ *
+ * Parameters: connection - Connection that has input
+ */
+inline void ValidationServer::receive(Connection& connection)
+{
+	char buffer[65536];
+	while (!connection.closing && !queueFull(connection))
+	{
+		ssize_t amount = read(connection.socket, buffer, sizeof buffer);
+		if (amount <= 0)
+		{
+			if (amount == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+				connection.closing = true; // Client is done sending (or gone)
+			break;
+		}
+		connection.input.append(buffer, amount);
+		split(connection);
+	}
+	if (connection.parsed == connection.input.size())
+	{
+		connection.input.clear();
+		connection.parsed = 0;
+	}
+	else if (connection.parsed > connection.input.size() / 2) // Don't let used bytes pile up
+	{
+		connection.input.erase(0, connection.parsed);
+		connection.parsed = 0;
+	}
+}
+
+/*
+ * split
+ *
+ * Moves the documents that arrived whole from the input to the queue.
+ *
+ * Parameters: connection - Connection that received input
+ */
+inline void ValidationServer::split(Connection& connection)
+{
+	while (connection.input.size() - connection.parsed >= 4)
+	{
+		const unsigned char *header = (const unsigned char *)connection.input.data() + connection.parsed;
+		std::uint32_t length = header[0] | header[1] << 8 | header[2] << 16 | (std::uint32_t)header[3] << 24;
+		if (length > MAXDOCUMENT)
+		{
+			connection.input.clear();
+			connection.parsed = 0;
+			connection.rejected = connection.closing = true;
+			return;
+		}
+		if (connection.input.size() - connection.parsed - 4 < length)
+			break; // The rest of the document hasn't arrived yet
+		connection.waiting.emplace_back(connection.input, connection.parsed + 4, length);
+		connection.waitingBytes += length;
+		connection.parsed += 4 + length;
+	}
+}
+
+/*
+ * send
+ *
+ * Writes as much of the waiting output as the socket takes.
+ *
+ * Parameters: connection - Connection to write to
+ */
+inline void ValidationServer::send(Connection& connection)
+{
+	std::size_t sent = 0;
+	while (sent < connection.output.size())
+	{
+		ssize_t amount = ::send(connection.socket, connection.output.data() + sent,
+			connection.output.size() - sent, MSG_NOSIGNAL);
+		if (amount <= 0)
+		{
+			if (amount < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				connection.output.clear(); // Client is gone
+				connection.waiting.clear();
+				connection.waitingBytes = 0;
+				connection.closing = true;
+				return;
+			}
+			break;
+		}
+		sent += amount;
+	}
+	connection.output.erase(0, sent);
+}
+
+/*
+ * collect
+ *
+ * Takes the responses the workers finished and sends them.
+ */
+inline void ValidationServer::collect()
+{
+	std::uint64_t count;
+	if (read(wakeDescriptor(), &count, sizeof count) < 0)
+		count = 0; // Nothing to reset
+	std::vector<std::pair<std::uint64_t, std::string> > responses;
+	{
+		std::lock_guard<std::mutex> guard(finishedLock);
+		responses.swap(finished);
+	}
+	for (auto& response : responses)
+	{
+		auto found = connections.find(response.first);
+		if (found == connections.end())
+			continue; // Connection was closed while validating
+		Connection& connection = found->second;
+		connection.validating = false;
+		connection.output += response.second;
+		validateNext(connection);
+		send(connection);
+		update(connection);
+	}
+}
+
+/*
+ * close
+ *
+ * Parameters: id - Number of the connection to close
+ */
+inline void ValidationServer::close(std::uint64_t id)
+{
+	auto found = connections.find(id);
+	if (found == connections.end())
+		return;
+	epoll_ctl(events, EPOLL_CTL_DEL, found->second.socket, nullptr);
+	::close(found->second.socket);
+	connections.erase(found);
+}
+
+/*
+ * run
+ *
+ * Serves requests until stop() is called (e.g. on SIGINT or SIGTERM).
+ *
+ * Parameters: path - Path of the Unix domain socket
+ * Returns: 0 once stopped, 1 if the server couldn't start
+ */
+inline int ValidationServer::run(const char* path)
+{
+	const std::uint64_t LISTENER = 0, WAKE = ~(std::uint64_t)0; // epoll tags that aren't connections
+	wakeDescriptor() = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	events = epoll_create1(EPOLL_CLOEXEC);
+	if (wakeDescriptor() < 0 || events < 0 || !listenOn(path))
+		return 1;
+
+	epoll_event event;
+	std::memset(&event, 0, sizeof event);
+	event.events = EPOLLIN;
+	event.data.u64 = LISTENER;
+	epoll_ctl(events, EPOLL_CTL_ADD, listener, &event);
+	event.data.u64 = WAKE;
+	epoll_ctl(events, EPOLL_CTL_ADD, wakeDescriptor(), &event);
+
+	std::cerr << "Listening on " << path << "\n";
+	epoll_event ready[256];
+	while (!stopping)
+	{
+		int amount = epoll_wait(events, ready, 256, -1);
+		if (amount < 0 && errno != EINTR)
+			break;
+		for (int i = 0; i < amount; i++)
+		{
+			std::uint64_t id = ready[i].data.u64;
+			if (id == LISTENER)
+			{
+				accept();
+				continue;
+			}
+			if (id == WAKE)
+			{
+				collect();
+				continue;
+			}
+			auto found = connections.find(id);
+			if (found == connections.end())
+				continue;
+			Connection& connection = found->second;
+			if (ready[i].events & (EPOLLHUP | EPOLLERR)) // Gone; nobody to answer
+			{
+				close(id);
+				continue;
+			}
+			if (ready[i].events & EPOLLIN)
+			{
+				receive(connection);
+				validateNext(connection);
+			}
+			if (!connection.output.empty())
+				send(connection);
+			update(connection);
+		}
+	}
+
+	pool.wait(); // Let the workers finish before the connections go away
+	while (!connections.empty())
+		close(connections.begin()->first);
+	::close(listener);
+	::close(events);
+	::close(wakeDescriptor());
+	wakeDescriptor() = -1;
+	unlink(path);
+	return 0;
+}
+
+#endif
+
+#endif
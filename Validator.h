@@ -0,0 +1,641 @@
+/*****************************************************
+ * Validator.h
+ *
+ * Validates one HTML document at a time against a
+ * TagDictionary, using a stack for the tags that are
+ * still open. A Validator only reads the dictionary,
+ * so many validators (e.g. one per thread) can share
+ * the same one.
+ *
+ * Author: Gustavo A. Rassi
+ ****************************************************/
+#ifndef VALIDATOR_H
+#define VALIDATOR_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ArrayStack.h"
+#include "AsciiCase.h"
+#include "CompressedInput.h"
+#include "MappedFile.h"
+#include "Stats.h"
+#include "TagDictionary.h"
+#include "Tokenizer.h"
+
+enum ValidationStatus
+{
+	VALID, // all tags are valid and correct with no issues
+	FILE_NOT_FOUND, // file doesn't exist or has the wrong path
+	MISSING_DOCTYPE, // line 1 isn't <!DOCTYPE html>
+	INVALID_TAG, // tag doesn't exist or is written incorrectly
+	MISMATCHED_TAG, // closing tag isn't the one for the most recent open tag
+	CLOSED_SELF_CLOSING, // a self-closing tag is trying to get closed
+	UNCLOSED_TAG, // opening tags are left unclosed at the end of the file
+	MISPLACED_TAG // the content model doesn't allow the tag where it is (only with rules)
+};
+
+struct ValidationError
+{
+	ValidationStatus status;
+	int line;
+	int column; // column of the '<', or 0 if it doesn't apply
+	std::string tag; // tag that caused the error
+	std::string expected; // for MISMATCHED_TAG: the open tag that should be closed;
+	                      // for MISPLACED_TAG: the tag it's in (empty outside of every tag)
+};
+
+/* The fields inherited from ValidationError describe the first error */
+struct ValidationResult : ValidationError
+{
+	std::vector<ValidationError> errors; // every error found, in the order found
+	bool truncated; // stopped at the maximum amount of errors
+};
+
+class Validator
+{
+	public:
+		Validator(const TagDictionary&, int = 1); // constructor, stops at the first error by default
+
+		void setMaxErrors(int); // amount of errors to collect before stopping
+		void reset(); // start a new document
+		void feed(const char*, size_t); // next chunk of the document
+		ValidationResult finish(); // end of the document
+		bool isDone() const; // true once the result can't change anymore
+		ValidationResult validate(const char*, const char*); // validate bytes in memory
+		ValidationResult validateFile(const char*); // validate a file, plain or compressed
+		ValidationResult validateCompressed(const char*, size_t, Compression); // decompress while validating
+	private:
+		struct Position
+		{
+			int line, column;
+		};
+
+		void addError(ValidationStatus, int, int, std::string_view, std::string_view = {});
+		void closeTag(const Token&); // handle a closing tag for a container tag
+		void popTag(); // close the most recent open tag
+		bool isClosedBy(int, int, const Token&) const; // does the closing tag close that open tag?
+		std::string_view nameOf(int, int) const; // name of an open tag
+		void checkPlacement(const Token&); // check an opening tag against the content model
+		void checkFirstLine(const char*&, const char*); // compare line 1 with DOCTYPE
+		void checkTags(); // run the tags of the current chunk through the stack
+
+		const TagDictionary& dictionary;
+		Tokenizer tokenizer;
+		ArrayStack<int> tags; // IDs of the open tags, reused for every document
+		std::vector<std::string> customTags; // names of the open custom elements, outermost first
+		ArrayStack<Position> openedAt; // where each open tag is (only when collecting)
+		ValidationResult result;
+		int maxErrors;
+		bool readingFirstLine; // still looking for the end of line 1
+		int doctypeLength; // characters of line 1 read so far
+		bool doctypeMismatch; // line 1 already differs from DOCTYPE
+};
+
+/* Line 1 of every document */
+constexpr std::string_view DOCTYPE = "<!DOCTYPE html>";
+
+/* Most errors kept when collecting all of them, unless told otherwise */
+const int DEFAULT_MAX_ERRORS = 100;
+
+/*
+ * Constructor
+ *
+ * Parameters: tagDictionary - Tags to validate against
+ *             errorLimit    - Amount of errors to collect before stopping
+ *                             (1 stops at the first error, like always)
+ */
+inline Validator::Validator(const TagDictionary& tagDictionary, int errorLimit)
+	: dictionary(tagDictionary), tokenizer(tagDictionary)
+{
+	setMaxErrors(errorLimit);
+	reset();
+}
+
+/*
+ * setMaxErrors
+ *
+ * With more than 1, the validator recovers from each error and goes on,
+ * which bounds the memory used by the error list.
+ *
+ * Parameters: errorLimit - Amount of errors to collect before stopping
+ */
+inline void Validator::setMaxErrors(int errorLimit)
+{
+	maxErrors = errorLimit < 1 ? 1 : errorLimit;
+}
+
+/*
+ * reset
+ *
+ * Forgets the current document. The stacks keep their storage.
+ */
+inline void Validator::reset()
+{
+	tags.clear();
+	customTags.clear();
+	openedAt.clear();
+	tokenizer.reset();
+	result.status = VALID;
+	result.line = 1;
+	result.column = 0;
+	result.tag.clear();
+	result.expected.clear();
+	result.errors.clear();
+	result.truncated = false;
+	readingFirstLine = true;
+	doctypeLength = 0;
+	doctypeMismatch = false;
+}
+
+/*
+ * addError
+ *
+ * Records an error. The first one is also kept in the result itself.
+ *
+ * Parameters: status   - Kind of error
+ *             line     - Line of the error
+ *             column   - Column of the error (0 if it doesn't apply)
+ *             tag      - Tag that caused the error
+ *             expected - Open tag that should have been closed, or the tag
+ *                        the misplaced tag is in, if any
+ */
+inline void Validator::addError(ValidationStatus status, int line, int column, std::string_view tag, std::string_view expected)
+{
+	ValidationError error = {status, line, column, std::string(tag), std::string(expected)};
+	if (result.errors.empty())
+		(ValidationError&)result = error;
+	result.errors.push_back(std::move(error));
+	if (maxErrors > 1 && (int)result.errors.size() == maxErrors)
+		result.truncated = true;
+}
+
+/*
+ * isClosedBy
+ *
+ * Custom elements all have the same ID, so their names are compared.
+ *
+ * Parameters: id     - ID of an open tag
+ *             custom - Index in customTags of its name, if it's a
+ *                      custom element
+ *             token  - The closing tag
+ * Returns: True if the closing tag is the one for that open tag
+ */
+inline bool Validator::isClosedBy(int id, int custom, const Token& token) const
+{
+	return id == token.id && (id != TagDictionary::CUSTOM_ID || AsciiCase::equalsAnyCase(customTags[custom], token.name));
+}
+
+/*
+ * nameOf
+ *
+ * Parameters: id     - ID of an open tag
+ *             custom - Index in customTags of its name, if it's a
+ *                      custom element
+ * Returns: Name of the tag
+ */
+inline std::string_view Validator::nameOf(int id, int custom) const
+{
+	return id == TagDictionary::CUSTOM_ID ? std::string_view(customTags[custom]) : std::string_view(dictionary.nameOf(id));
+}
+
+/*
+ * popTag
+ *
+ * Closes the most recent open tag, with its name if it's a custom element.
+ */
+inline void Validator::popTag()
+{
+	if (tags.top() == TagDictionary::CUSTOM_ID)
+		customTags.pop_back();
+	tags.pop();
+	if (!openedAt.isEmpty())
+		openedAt.pop();
+}
+
+/*
+ * closeTag
+ *
+ * Closes the most recent open tag if it's the one being closed. Otherwise
+ * it's an error; when collecting errors, the validator recovers by closing
+ * the nearest open tag with the same name (and everything opened after
+ * it), or by ignoring the closing tag if that tag isn't open at all.
+ *
+ * Parameters: token - The closing tag
+ */
+inline void Validator::closeTag(const Token& token)
+{
+	// If the tag matches with the most recent in the stack, close it
+	int custom = (int)customTags.size() - 1; // name of the innermost open custom element
+	if (!tags.isEmpty() && isClosedBy(tags.top(), custom, token))
+	{
+		popTag();
+		STATS_COUNT(POPS);
+		return;
+	}
+
+	addError(MISMATCHED_TAG, token.line, tokenizer.columnOf(token), token.name,
+		tags.isEmpty() ? std::string_view() : nameOf(tags.top(), custom));
+	if (isDone())
+		return;
+
+	// Recovery: pop to the nearest matching ancestor, if there's one
+	for (int depth = 1; depth < tags.size(); depth++)
+	{
+		if (tags.peek(depth - 1) == TagDictionary::CUSTOM_ID)
+			custom--;
+		if (isClosedBy(tags.peek(depth), custom, token))
+		{
+			for (int i = 0; i <= depth; i++)
+				popTag();
+			STATS_ADD(POPS, depth + 1);
+			return;
+		}
+	}
+}
+
+/*
+ * checkFirstLine
+ *
+ * Compares the part of line 1 in the chunk with <!DOCTYPE html>, without
+ * keeping a copy of the line.
+ *
+ * Parameters: data - First byte of the chunk; moved to the end of line 1
+ *                    (the '\n') if the line ends in this chunk
+ *             end  - One past the last byte of the chunk
+ */
+inline void Validator::checkFirstLine(const char*& data, const char* end)
+{
+	const char *lineEnd = std::find(data, end, '\n');
+	for (; data != lineEnd && !doctypeMismatch; data++, doctypeLength++)
+		if (doctypeLength >= (int)DOCTYPE.size() || *data != DOCTYPE[doctypeLength])
+			doctypeMismatch = true;
+	data = lineEnd;
+	if (lineEnd == end) // Line 1 goes on in the next chunk
+		return;
+
+	readingFirstLine = false;
+	if (doctypeMismatch || doctypeLength != (int)DOCTYPE.size())
+		addError(MISSING_DOCTYPE, 1, 0, "");
+}
+
+/*
+ * checkTags
+ *
+ * Checks that every tag exists, that tags are closed in the right order
+ * and, with rules, that each tag is allowed where it's opened, until the
+ * chunk is used up or there are enough errors.
+ */
+inline void Validator::checkTags()
+{
+	Token token;
+	while (!isDone() && tokenizer.next(token))
+	{
+		TagKind kind = dictionary.kindOf(token.id); // Tag was already looked up by the tokenizer
+
+		if (token.closing) // It's a closing tag
+		{
+			if (kind == CONTAINER_TAG)
+				closeTag(token);
+			else if (kind == SELF_CLOSING_TAG) // Trying to close a self-closing tag
+				addError(CLOSED_SELF_CLOSING, token.line, tokenizer.columnOf(token), token.name);
+			else // Tag is not valid nor is correct
+				addError(INVALID_TAG, token.line, tokenizer.columnOf(token), token.name);
+		}
+		// It's valid but not a self-closing tag, so a tag has opened
+		else if (kind == CONTAINER_TAG)
+		{
+			checkPlacement(token); // Still opened if it's misplaced, to go on from there
+			tags.push(token.id);
+			if (token.id == TagDictionary::CUSTOM_ID)
+				customTags.emplace_back(token.name);
+			STATS_COUNT(PUSHES);
+			STATS_DEPTH(tags.size());
+			if (maxErrors > 1) // Only needed to report unclosed tags where they are
+				openedAt.push({token.line, tokenizer.columnOf(token)});
+		}
+		else if (kind == SELF_CLOSING_TAG)
+			checkPlacement(token);
+		// Tag doesn't exist or written incorrectly, so there's an error
+		else if (kind == UNKNOWN_TAG)
+			addError(INVALID_TAG, token.line, tokenizer.columnOf(token), token.name);
+	}
+}
+
+/*
+ * checkPlacement
+ *
+ * Checks that the content model allows an opening tag right inside the
+ * most recent open tag: a single bit lookup.
+ *
+ * Parameters: token - The opening tag
+ */
+inline void Validator::checkPlacement(const Token& token)
+{
+	int parent = tags.isEmpty() ? ContentModel::TOP : tags.top();
+	if (!dictionary.contentModel().allows(parent, token.id))
+		addError(MISPLACED_TAG, token.line, tokenizer.columnOf(token), token.name,
+			parent == ContentModel::TOP ? std::string_view() : nameOf(parent, (int)customTags.size() - 1));
+}
+
+/*
+ * feed
+ *
+ * Validates the next chunk of the document. Chunks can be of any size
+ * and may cut a tag anywhere; the chunk doesn't need to be kept after
+ * the call returns. Once enough errors are found, the rest is ignored.
+ *
+ * Parameters: data   - Bytes of the chunk
+ *             length - Amount of bytes
+ */
+inline void Validator::feed(const char* data, size_t length)
+{
+	const char *end = data + length;
+	if (isDone())
+		return;
+	if (readingFirstLine)
+	{
+		checkFirstLine(data, end);
+		if (readingFirstLine || isDone())
+			return;
+	}
+	tokenizer.feed(data, end); // Starts at the end of line 1
+	checkTags();
+}
+
+/*
+ * finish
+ *
+ * Ends the document and validates what's left of it.
+ *
+ * Returns: Result of the validation
+ */
+inline ValidationResult Validator::finish()
+{
+	if (readingFirstLine) // The whole document is a single line
+	{
+		readingFirstLine = false;
+		if (doctypeMismatch || doctypeLength != (int)DOCTYPE.size())
+			addError(MISSING_DOCTYPE, 1, 0, "");
+	}
+	if (!isDone())
+	{
+		tokenizer.feed(nullptr, nullptr, true); // Flush a tag cut by the end
+		checkTags();
+	}
+
+	if (!isDone()) // The whole file was read
+	{
+		if (maxErrors == 1)
+		{
+			result.line = tokenizer.lastLine();
+			if (!tags.isEmpty()) // Opening tags are left unclosed
+				addError(UNCLOSED_TAG, tokenizer.lastLine(), 0, nameOf(tags.top(), (int)customTags.size() - 1));
+		}
+		else // Report every open tag where it was opened, outermost first
+		{
+			int custom = 0;
+			for (int depth = tags.size() - 1; depth >= 0 && !isDone(); depth--)
+			{
+				addError(UNCLOSED_TAG, openedAt.peek(depth).line, openedAt.peek(depth).column,
+					nameOf(tags.peek(depth), custom));
+				if (tags.peek(depth) == TagDictionary::CUSTOM_ID)
+					custom++;
+			}
+		}
+	}
+	return result;
+}
+
+/*
+ * isDone
+ *
+ * Returns: True if enough errors were found, so the rest of the
+ *          document doesn't need to be fed
+ */
+inline bool Validator::isDone() const
+{
+	return (int)result.errors.size() >= maxErrors;
+}
+
+/*
+ * validate
+ *
+ * Validates a whole document that's already in memory.
+ *
+ * Parameters: begin - First byte of the document
+ *             end   - One past the last byte of the document
+ * Returns: Result of the validation
+ */
+inline ValidationResult Validator::validate(const char* begin, const char* end)
+{
+	STATS_PHASE(VALIDATE);
+	STATS_COUNT(DOCUMENTS);
+	STATS_ADD(BYTES, end - begin);
+	reset();
+	feed(begin, end - begin);
+	return finish();
+}
+
+/*
+ * validateFile
+ *
+ * Parameters: path - Path of the HTML file
+ * Returns: Result of the validation
+ */
+inline ValidationResult Validator::validateFile(const char* path)
+{
+	MappedFile import; // Link with the HTML file, without copying it
+	bool opened;
+	{
+		STATS_PHASE(READ_FILE); // Mapping is quick; the pages are read while validating
+		opened = import.open(path);
+	}
+	if (!opened)
+	{
+		reset();
+		addError(FILE_NOT_FOUND, 0, 0, "");
+		return result;
+	}
+	Compression compression = compressionOf(import.data(), import.size());
+	if (compression != UNCOMPRESSED)
+		return validateCompressed(import.data(), import.size(), compression);
+	return validate(import.data(), import.data() + import.size());
+}
+
+/*
+ * validateCompressed
+ *
+ * Validates each block as soon as it's decompressed, while the next
+ * ones are decompressed on another thread. Decompressing stops once
+ * enough errors are found.
+ *
+ * Parameters: data        - Compressed bytes of the document
+ *             size        - Amount of compressed bytes
+ *             compression - How they are compressed
+ * Returns: Result of the validation; FILE_NOT_FOUND if the document
+ *          can't be decompressed (damaged, or no codec built in)
+ */
+inline ValidationResult Validator::validateCompressed(const char* data, size_t size, Compression compression)
+{
+	STATS_PHASE(VALIDATE);
+	STATS_COUNT(DOCUMENTS);
+	reset();
+	if (!canDecompress(compression))
+	{
+		addError(FILE_NOT_FOUND, 0, 0, "");
+		return result;
+	}
+	Decompressor input(data, size, compression);
+	const char *block;
+	size_t length;
+	while (!isDone() && input.next(block, length))
+	{
+		STATS_ADD(BYTES, length);
+		feed(block, length);
+	}
+	if (!isDone() && input.failed())
+	{
+		reset();
+		addError(FILE_NOT_FOUND, 0, 0, "");
+		return result;
+	}
+	return finish();
+}
+
+/*
+ * resultMessage
+ *
+ * Parameters: result - Result of a validation (or one of its errors)
+ * Returns: Message describing the result, in a single line
+ */
+inline std::string resultMessage(const ValidationError& result)
+{
+	std::string line = std::to_string(result.line);
+	switch (result.status)
+	{
+		case VALID:
+			return "Compiled successfully: HTML file is valid!";
+		case FILE_NOT_FOUND:
+			return "File does not exist or has the wrong path";
+		case MISSING_DOCTYPE:
+			return "Error: DOCTYPE must be in line 1";
+		case INVALID_TAG:
+		case MISMATCHED_TAG:
+			return "Error in line " + line + ": Invalid or missing tag with '" + result.tag + "'";
+		case CLOSED_SELF_CLOSING:
+			return "Error in line " + line + ": '" + result.tag + "' is a self-closing tag";
+		case UNCLOSED_TAG:
+			return "Error in line " + line + ": '" + result.tag + "' must have its closing tag";
+		case MISPLACED_TAG:
+			if (result.expected.empty())
+				return "Error in line " + line + ": '" + result.tag + "' can't be outside of another tag";
+			return "Error in line " + line + ": '" + result.tag + "' can't be inside '" + result.expected + "'";
+	}
+	return "";
+}
+
+/*
+ * statusName
+ *
+ * Parameters: status - Kind of result
+ * Returns: Short name of the status, for output read by programs
+ */
+inline const char* statusName(ValidationStatus status)
+{
+	switch (status)
+	{
+		case VALID:
+			return "valid";
+		case FILE_NOT_FOUND:
+			return "file_not_found";
+		case MISSING_DOCTYPE:
+			return "missing_doctype";
+		case INVALID_TAG:
+			return "invalid_tag";
+		case MISMATCHED_TAG:
+			return "mismatched_tag";
+		case CLOSED_SELF_CLOSING:
+			return "closed_self_closing";
+		case UNCLOSED_TAG:
+			return "unclosed_tag";
+		case MISPLACED_TAG:
+			return "misplaced_tag";
+	}
+	return "";
+}
+
+/*
+ * printResult
+ *
+ * Prints the result of validating a single file, spaced the same way
+ * the validator always has.
+ *
+ * Parameters: os     - Output stream to use
+ *             result - Result of the validation
+ */
+inline void printResult(std::ostream& os, const ValidationResult& result)
+{
+	switch (result.status)
+	{
+		case VALID:
+		case FILE_NOT_FOUND:
+		case MISSING_DOCTYPE:
+			os << "\n" << resultMessage(result) << "\n" << std::endl;
+			break;
+		case INVALID_TAG:
+		case MISMATCHED_TAG:
+		case CLOSED_SELF_CLOSING:
+		case MISPLACED_TAG:
+			os << "\n" << resultMessage(result) << "\n";
+			break;
+		case UNCLOSED_TAG:
+			os << resultMessage(result) << "\n";
+			break;
+	}
+}
+
+/*
+ * errorMessage
+ *
+ * Describes one of the errors collected, including its column and,
+ * for a mismatched closing tag, which tag was expected.
+ *
+ * Parameters: error - Error to describe
+ * Returns: Message describing the error, in a single line
+ */
+inline std::string errorMessage(const ValidationError& error)
+{
+	std::string message = resultMessage(error);
+	if (error.column > 0)
+	{
+		std::string where = "Error in line " + std::to_string(error.line);
+		message.insert(where.size(), ", column " + std::to_string(error.column));
+	}
+	if (error.status == MISMATCHED_TAG && !error.expected.empty())
+		message += " (expected the closing tag of '" + error.expected + "')";
+	return message;
+}
+
+/*
+ * printErrors
+ *
+ * Prints every error collected, one per line.
+ *
+ * Parameters: os     - Output stream to use
+ *             result - Result of the validation
+ *             prefix - Printed before each line (e.g. the file name)
+ */
+inline void printErrors(std::ostream& os, const ValidationResult& result, const std::string& prefix = "")
+{
+	if (result.errors.empty())
+		os << prefix << resultMessage(result) << "\n";
+	for (size_t i = 0; i < result.errors.size(); i++)
+		os << prefix << errorMessage(result.errors[i]) << "\n";
+	if (result.truncated)
+		os << prefix << "Stopped after " << result.errors.size() << " errors\n";
+}
+
+#endif